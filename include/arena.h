@@ -0,0 +1,61 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include "yyjson.h"
+
+/**
+ * Bump-pointer arena for request-scoped memory.
+ *
+ * Allocations are never freed individually; arena_reset() drops all of them
+ * at once and keeps the chunks for the next request on the same connection.
+ * A zero-initialised Arena is valid and empty. Not thread-safe.
+ */
+
+#define ARENA_CHUNK_SIZE 4096          // Default chunk payload
+#define ARENA_KEEP_MAX (64 * 1024)     // Capacity kept across arena_reset()
+
+typedef struct ArenaChunk ArenaChunk;
+
+typedef struct {
+    ArenaChunk* first;
+    ArenaChunk* current;   // Chunks after this one are free
+    size_t capacity;       // Payload bytes of all chunks
+    yyjson_alc alc;        // See arena_yyjson_alc()
+} Arena;
+
+/**
+ * @brief Allocates `size` bytes, aligned for any type.
+ * @return The memory, or NULL if out of memory.
+ */
+void* arena_alloc(Arena* arena, size_t size);
+
+/**
+ * @brief Copies `len` bytes of `str` and NUL-terminates the copy.
+ */
+char* arena_strndup(Arena* arena, const char* str, size_t len);
+
+/**
+ * @brief Copies a NUL-terminated string; NULL stays NULL.
+ */
+char* arena_strdup(Arena* arena, const char* str);
+
+/**
+ * @brief Releases every allocation. Chunks up to ARENA_KEEP_MAX are kept.
+ */
+void arena_reset(Arena* arena);
+
+/**
+ * @brief Releases every allocation and all chunks.
+ */
+void arena_destroy(Arena* arena);
+
+/**
+ * @brief A yyjson allocator backed by the arena.
+ *
+ * Documents built with it need no yyjson_doc_free()/yyjson_mut_doc_free()
+ * (calling them is harmless); they go away with the next arena_reset().
+ */
+const yyjson_alc* arena_yyjson_alc(Arena* arena);
+
+#endif // ARENA_H
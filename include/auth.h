@@ -4,6 +4,19 @@
 #include "http.h"
 #include "config.h"
 
+/**
+ * @brief Prepares per-key authentication state from the configuration.
+ *
+ * Precomputes the HMAC-SHA256 inner/outer pad states for jwt_secret so the
+ * native HS256 verifier does not re-derive them per request, loads the public
+ * keys for asymmetric algorithms (JwtPublicKey / JwtJwksFile), and loads the
+ * token revocation snapshot. Called by loadConfig(); call again if the JWT
+ * settings change.
+ *
+ * @param config The server configuration, containing JWT settings.
+ */
+void auth_init(const ServerConfig* config);
+
 /**
  * @brief Authenticates an incoming request based on the Authorization header.
  * 
@@ -13,6 +26,9 @@
  * It checks for a "Bearer <token>" in the Authorization header.
  * If validation is successful, it returns the username (e.g., from the 'sub' claim).
  * 
+ * On success the token's "roles" claim (an array of strings, or a
+ * comma-separated string) is stored in conn->request.auth_roles.
+ *
  * @param conn The connection object, containing the parsed request.
  * @param config The server configuration, containing JWT settings.
  * @return A dynamically allocated string with the username on success (caller must free).
@@ -20,11 +36,63 @@
  */
 char* authenticate_request(Connection* conn, ServerConfig* config);
 
+/**
+ * @brief Checks an authenticated request against a list of roles.
+ *
+ * @param req The request, after successful authentication.
+ * @param roles Comma-separated role names; NULL or "" always matches.
+ * @return true if the token carries at least one of the roles.
+ */
+bool auth_has_role(const HttpRequest* req, const char* roles);
+
+/**
+ * @brief Forgets the authentication remembered on a connection.
+ *
+ * authenticate_request() remembers the last accepted token on the Connection,
+ * so further keep-alive requests with the same header skip verification until
+ * the token expires (revocation is still checked). The server calls this when
+ * the connection is freed.
+ */
+void auth_context_clear(Connection* conn);
+
+/**
+ * @brief Receives the result of authenticate_request_async().
+ *
+ * Runs on the reactor thread. @p username is heap-allocated (the callback
+ * owns it) or NULL if authentication failed.
+ */
+typedef void (*AuthCallback)(Connection* conn, ServerConfig* config, int epollFd, char* username);
+
+/**
+ * @brief Authenticates a request without blocking the event loop.
+ *
+ * With an asymmetric JwtAlgorithm (RS*, PS*, ES*, EdDSA), tokens missing from
+ * the validated-token cache are verified on the worker pool and @p callback
+ * runs once that finishes. In every other case (no token, cache hit, HMAC,
+ * mock tokens) it runs before this function returns. If the client disconnects
+ * in the meantime, the callback is skipped.
+ *
+ * authenticate_request() stays available but performs public-key checks inline.
+ *
+ * @param conn The connection object, containing the parsed request.
+ * @param config The server configuration; must outlive the request.
+ * @param epollFd Passed through to the callback, for queue_data_for_writing().
+ * @param callback Completion, see AuthCallback.
+ */
+void authenticate_request_async(Connection* conn, ServerConfig* config, int epollFd, AuthCallback callback);
+
+/**
+ * @brief True if the configuration needs the verification worker pool
+ * (asymmetric JwtAlgorithm and JwtVerifyThreads > 0).
+ */
+bool auth_needs_worker_pool(const ServerConfig* config);
+
 /**
  * @brief Generates a token for a given user.
  * 
  * This function encapsulates the logic for creating either a real JWT or a mock token,
- * based on the server's configuration (jwt_enabled).
+ * based on the server's configuration (jwt_enabled). Real tokens can only be
+ * issued with an HS* JwtAlgorithm, since only public keys are configured otherwise.
  * 
  * @param username The username for whom to generate the token.
  * @param config The server configuration, containing JWT settings.
@@ -33,5 +101,35 @@ char* authenticate_request(Connection* conn, ServerConfig* config);
  */
 char* generate_token_for_user(const char* username, ServerConfig* config);
 
+/**
+ * @brief Revokes a token so authenticate_request() rejects it from now on.
+ *
+ * The token must still be valid. Tokens carrying a 'jti' are revoked
+ * individually; older tokens without one revoke all of the user's tokens
+ * issued up to this one. Revocations are persisted to the configured
+ * RevocationSnapshot file.
+ *
+ * @param token The raw JWT (without the "Bearer " prefix).
+ * @param config The server configuration, containing JWT settings.
+ * @return 0 on success, -1 if the token is invalid or could not be revoked.
+ */
+int auth_revoke_token(const char* token, ServerConfig* config);
+
+/**
+ * @brief Revokes the Bearer token presented with the current request (logout).
+ *
+ * @param conn The connection object, containing the parsed request.
+ * @param config The server configuration, containing JWT settings.
+ * @return 0 on success, -1 on failure.
+ */
+int auth_revoke_request_token(Connection* conn, ServerConfig* config);
+
+/**
+ * @brief Revokes every token issued to a user so far ("log out everywhere").
+ *
+ * @param username The user whose tokens should be rejected.
+ * @return 0 on success, -1 on failure.
+ */
+int auth_revoke_user(const char* username);
 
 #endif // AUTH_H 
\ No newline at end of file
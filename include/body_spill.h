@@ -0,0 +1,69 @@
+#ifndef BODY_SPILL_H
+#define BODY_SPILL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+#include "yyjson.h"
+
+// Zero bytes mapped behind a spilled body: its NUL terminator plus in-situ JSON padding
+#define BODY_SPILL_PADDING YYJSON_PADDING_SIZE
+
+/**
+ * Keeps buffered request bodies from exhausting memory.
+ *
+ * Bodies up to BodyMemoryThreshold bytes stay in the connection's read buffer
+ * as long as all such bodies together fit in BodyMemoryBudget. Anything else
+ * is written to an anonymous temporary file (O_TMPFILE in BodySpillDir) and
+ * handed to the handler as a private mapping of that file, so an upload burst
+ * turns into disk I/O and reclaimable page cache instead of heap.
+ */
+
+/**
+ * @brief Applies BodyMemoryThreshold, BodyMemoryBudget and BodySpillDir.
+ */
+void body_spill_init(const ServerConfig* config);
+
+/**
+ * @brief Grows a body's in-memory reservation from `current` to `wanted` bytes.
+ *
+ * Fails if `wanted` is above the threshold or the extra bytes do not fit in
+ * the global budget; the body should then be spilled. On success the extra
+ * bytes are charged until body_memory_release(); on failure nothing is.
+ */
+bool body_memory_reserve(size_t current, size_t wanted);
+
+/**
+ * @brief Returns bytes charged by body_memory_reserve() to the budget.
+ */
+void body_memory_release(size_t bytes);
+
+/**
+ * @brief Creates an unnamed temporary file for a body.
+ * @return A file descriptor, or -1 on error.
+ */
+int body_spill_open();
+
+/**
+ * @brief Appends body data to the file.
+ * @return 0 on success, -1 on error (e.g. disk full).
+ */
+int body_spill_write(int fd, const char* data, size_t len);
+
+/**
+ * @brief Maps a complete body of `len` bytes.
+ *
+ * The mapping is private (writes stay in memory) and followed by
+ * BODY_SPILL_PADDING zero bytes, the first being the NUL terminator an
+ * in-memory body has as well. Release it with body_spill_unmap().
+ *
+ * @return The mapped body, or NULL on error.
+ */
+char* body_spill_map(int fd, size_t len);
+
+/**
+ * @brief Releases a mapping returned by body_spill_map().
+ */
+void body_spill_unmap(char* body, size_t len);
+
+#endif // BODY_SPILL_H
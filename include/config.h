@@ -9,11 +9,28 @@ typedef struct {
     char log_path[256];
     LogLevel log_level;
     LogTarget log_target;
+    int log_rate_limit;          // Per-call-site lines/second for noisy messages, 0 = unlimited
+    int access_log_sample_rate;  // Log 1 in N successful requests
+    int log_rotate_size_mb;      // Rotate a log file once it reaches this size, 0 = never
+    int log_rotate_daily;        // Rotate log files at local midnight
     
     // JWT and other settings
     int jwt_enabled;
     char jwt_secret[256];
+    char jwt_algorithm[16];        // HS256 (default), RS256, ES256, EdDSA, ...
+    char jwt_public_key[256];      // PEM file for asymmetric algorithms
+    char jwt_jwks_file[256];       // JWKS file, keys selected by "kid"
+    int jwt_verify_threads;        // Worker threads for asymmetric signature checks
+    long jwt_max_token_lifetime;   // Seconds; tokens with a longer exp - iat (or without either) are rejected
+    char revocation_snapshot[256]; // File persisting revoked tokens, "" = memory only
     int mime_enabled;
+    size_t static_mmap_threshold;  // Static files of at least this size are sent from a shared mmap, 0 = never
+    size_t static_mmap_cache_size; // Bytes of such mappings kept for reuse
+    char mime_types_file[256];     // mime.types file extending the built-in types, "" = built-ins only
+    size_t max_body_size;          // Largest accepted request body in bytes (413 above), 0 = unlimited
+    size_t body_memory_threshold;  // Larger bodies are spilled to a temp file, 0 = no per-body limit
+    size_t body_memory_budget;     // Bytes of in-memory bodies across all connections, 0 = unlimited
+    char body_spill_dir[256];      // Where spilled bodies go (O_TMPFILE, never visible by name)
 } ServerConfig;
 
 /**
@@ -0,0 +1,65 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include "config.h"
+
+/**
+ * Shared read-only mappings of static files.
+ *
+ * Files of at least StaticMmapThreshold bytes are served from an mmap of the
+ * file instead of being read into each connection's write buffer: every
+ * connection sending the same file borrows slices of one mapping, backed
+ * directly by the page cache. Mappings are reference counted and, up to
+ * StaticMmapCacheSize bytes in total, kept for later requests. Beyond that
+ * the least recently used idle ones are unmapped. An inotify watch drops a
+ * mapping as soon as its file is modified, replaced or deleted; a file that
+ * changed unnoticed is also caught by its size/mtime on the next request.
+ *
+ * Reactor thread only.
+ */
+
+typedef struct FileMapping FileMapping;
+
+/**
+ * @brief Applies StaticMmapThreshold and StaticMmapCacheSize and sets up the inotify fd.
+ */
+void file_cache_init(const ServerConfig* config);
+
+/**
+ * @brief True if a file of this size should be served through file_cache_acquire().
+ */
+bool file_cache_wants(size_t size);
+
+/**
+ * @brief Returns a mapping of the open file `fd`, creating it if needed.
+ *
+ * The caller may close `fd` afterwards. Each successful call must be paired
+ * with file_cache_release().
+ *
+ * @param st The file's fstat(), identifying it (device/inode) and its version (size/mtime).
+ * @return The mapping, or NULL if the file cannot be mapped (serve it by read() instead).
+ */
+FileMapping* file_cache_acquire(int fd, const struct stat* st);
+
+/**
+ * @brief Drops a reference; the mapping is unmapped once unused and no longer cached.
+ */
+void file_cache_release(FileMapping* map);
+
+const char* file_cache_data(const FileMapping* map);
+size_t file_cache_size(const FileMapping* map);
+
+/**
+ * @brief The inotify fd to watch for EPOLLIN, or -1 if change notification is unavailable.
+ */
+int file_cache_event_fd(void);
+
+/**
+ * @brief Reads pending inotify events and drops the mappings of changed files.
+ */
+void file_cache_handle_events(void);
+
+#endif // FILE_CACHE_H
@@ -2,9 +2,12 @@
 #define HTTP_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <time.h>
 #include <netinet/in.h> // For INET_ADDRSTRLEN
 #include "config.h" // For ServerConfig
 #include "yyjson.h" // Phase 3: JSON support
+#include "arena.h"
 
 typedef enum {
     PARSE_STATE_REQ_LINE,
@@ -14,7 +17,17 @@ typedef enum {
     PARSE_STATE_SENDING // New state: Request handling finished, sending response
 } ParsingState;
 
+// Chunked Transfer-Encoding decoder state (see http_chunked_decode)
+typedef enum {
+    CHUNK_STATE_SIZE,      // Expecting "<hex size>[;ext]\r\n"
+    CHUNK_STATE_DATA,      // Inside chunk data
+    CHUNK_STATE_DATA_END,  // CRLF after the chunk data
+    CHUNK_STATE_TRAILER,   // Trailer fields up to the empty line
+    CHUNK_STATE_DONE
+} ChunkState;
+
 #define MAX_HEADERS 32
+#define MAX_HEADER_SIZE (64 * 1024) // Request line + headers (and, separately, trailers)
 #define MAX_PARAMS 32
 
 typedef struct {
@@ -22,7 +35,8 @@ typedef struct {
     char* value;
 } HttpHeader;
 
-// Key-Value pair for parsed parameters (query string or form body)
+// Key-Value pair for parsed parameters (query string or form body).
+// Both point into request-owned memory (see parse_params), they are not freed.
 typedef struct {
     char* key;
     char* value;
@@ -45,21 +59,66 @@ typedef struct {
     char* body;
     size_t content_length;
 
-    // Pre-parsed parameters (Phase 2)
+    // Parameters (Phase 2), filled on first lookup
     QueryParam query_params[MAX_PARAMS];  // Parsed from query string
     int query_param_count;
     QueryParam body_params[MAX_PARAMS];   // Parsed from form body (x-www-form-urlencoded)
     int body_param_count;
 
-    // JSON body (Phase 3) - auto-parsed when Content-Type is application/json
+    // JSON body (Phase 3) - parsed by http_get_json_root() when Content-Type is application/json
     yyjson_doc* json_doc;   // Immutable JSON document (for reading)
     yyjson_val* json_root;  // Root value of the JSON document
+    yyjson_read_err json_err; // Why json_root is NULL for a JSON body (code, msg, byte position)
+
+    // Parsed on first access (utils.h getters)
+    bool query_parsed;
+    bool body_parsed;
+    bool json_parsed;
 
     // Fields for authentication
     const char* auth_token; // Raw token from header
     char* authed_user;      // Decoded username after validation
+    char* auth_roles;       // Comma-separated roles of the validated token, or NULL
+
+    const struct Route* route; // Matched once the headers are complete (NULL = static file)
+
+    // Body framing, decoded in place in read_buf
+    bool has_content_length;
+    bool chunked;           // Transfer-Encoding: chunked
+    bool expect_continue;   // "Expect: 100-continue" not answered yet
+    ChunkState chunk_state;
+    size_t chunk_remaining; // Data bytes left in the current chunk
+    size_t trailer_bytes;   // Trailer section so far, capped at MAX_HEADER_SIZE
+    size_t body_start;      // Offset of the decoded body in read_buf
+    size_t body_pending;    // Decoded bytes at body_start (not yet handed to a stream handler)
+    size_t body_received;   // Decoded body bytes so far
+    size_t body_mem_reserved; // Charged to the body memory budget (body_spill.h)
+    bool body_spilled;      // The body goes to body_fd; once complete, body maps that file
+    size_t body_padding;    // Writable bytes from body[content_length] on (in-situ JSON parsing)
+    int body_fd;
+
+    // Streaming bodies (router_add_stream_route)
+    bool stream_started;    // on_headers accepted, on_complete not yet called
+    void* stream_ctx;       // Free for the stream handler's use
+
+    // Backs the strings above, the JSON document and whatever handlers allocate
+    // from it (arena_alloc, arena_yyjson_alc). Released with the request.
+    Arena arena;
 } HttpRequest;
 
+// Authentication remembered across the requests of a keep-alive connection.
+// Owned by auth.c; freed with the connection, not between requests.
+typedef struct {
+    char* token;        // Last validated token (NULL = nothing remembered)
+    size_t token_len;
+    uint64_t token_hash;
+    char* sub;
+    char* jti;          // NULL if absent
+    char* roles;        // NULL if absent
+    time_t exp;
+    time_t iat;
+} AuthContext;
+
 // Represents a single client connection
 typedef struct Connection {
     int fd;
@@ -75,11 +134,32 @@ typedef struct Connection {
     size_t write_buf_size;
     size_t write_len; // How much data is in the buffer
     size_t write_pos; // How much has been sent
+    bool write_armed; // EPOLLOUT is registered
+
+    // Streaming response (http_response_begin_chunked)
+    bool response_streaming; // Begun and not yet ended by http_response_end()
+    bool response_chunked;   // Chunked framing; false = delimited by closing (HTTP/1.0)
+    void (*on_drain)(struct Connection* conn, void* ctx, int epollFd);
+    void* drain_ctx;
+
+    // Borrowed output after write_buf: a slice of a shared file mapping (file_cache.h)
+    struct FileMapping* write_map;
+    size_t write_map_pos;   // Next byte of the mapping to send
+    size_t write_map_end;   // One past the last byte to send
 
     // Parsing state
     ParsingState parsing_state;
     size_t parsed_offset; // How much of read_buf has been processed
     HttpRequest request;    // The request being built
+    AuthContext auth;       // Survives resetConnectionForNextRequest()
+
+    // Deferred work (e.g. JWT verification on the worker pool), see server_async_begin()
+    int async_pending;      // Outstanding jobs that will call back into this connection
+    bool closed;            // Closed while jobs were pending, freed by the last server_async_end()
+    bool read_deferred;     // EPOLLIN arrived while jobs were pending
+    bool body_restore;      // read_buf[parsed_offset] still holds the body's NUL terminator
+    char body_saved_char;   // The byte it replaced
+    bool in_middleware;     // Route middleware is running synchronously (server.c)
 } Connection;
 
 
@@ -91,9 +171,34 @@ int parseHttpRequest(char* requestStr, size_t requestLen, HttpRequest* req);
 // Frees the memory allocated for an HttpRequest.
 void freeHttpRequest(HttpRequest* req);
 
+/**
+ * @brief Incrementally decodes a chunked request body in place.
+ *
+ * Consumes framing and data from buf[*in, len) and appends the chunk data at
+ * buf[*out] (always *out <= *in, so no second buffer is needed). State is kept
+ * in req between calls; trailer fields are appended to req->headers.
+ *
+ * @return 1 once the last chunk and the trailers are consumed, 0 if more input
+ *         is needed, -1 if the framing is malformed or the trailers exceed
+ *         MAX_HEADER_SIZE bytes or the free header slots.
+ */
+int http_chunked_decode(HttpRequest* req, char* buf, size_t len, size_t* in, size_t* out);
+
 // Returns the MIME type for a given file path.
 // const char* getMimeType(const char* path); // This is now in utils.h
 
+/**
+ * @brief Opens DocumentRoot once; static files are then resolved relative to it.
+ *
+ * Paths are opened with openat2(RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS), so
+ * the kernel refuses anything resolving outside DocumentRoot, including via
+ * ".." or symlinks. Kernels without openat2 get a lexically normalised
+ * openat() instead. Called by startServer(), which refuses to start on failure.
+ *
+ * @return 0 on success, -1 if DocumentRoot cannot be opened as a directory.
+ */
+int http_static_init(const ServerConfig* config);
+
 // Handles a request for a static file.
 void handleStaticRequest(Connection* conn, const ServerConfig* config, int epollFd);
 
@@ -0,0 +1,44 @@
+#ifndef JSON_SCHEMA_H
+#define JSON_SCHEMA_H
+
+#include <stddef.h>
+#include "yyjson.h"
+
+/**
+ * Request body validation against a JSON Schema subset, compiled once.
+ *
+ * Supported keywords:
+ *   type                 "object", "array", "string", "integer", "number",
+ *                        "boolean", "null", or an array of these
+ *   properties, required, additionalProperties (false only)
+ *   items, minItems, maxItems
+ *   minLength, maxLength (code points)
+ *   minimum, maximum     (inclusive)
+ *   enum                 (scalar values)
+ * Annotations ($schema, $id, title, description, default, examples) are
+ * ignored; any other keyword is a compile error rather than silently skipped.
+ *
+ * The schema becomes a flat array of nodes. Object members are matched
+ * against precomputed key hashes in a single pass over the payload, without
+ * per-property yyjson_obj_get() lookups.
+ */
+
+typedef struct JsonSchema JsonSchema;
+
+/**
+ * @brief Compiles a schema given as JSON text.
+ * @param err Receives the reason on failure (may be NULL).
+ * @return The schema, or NULL if it is malformed or uses unsupported keywords.
+ */
+JsonSchema* json_schema_compile(const char* schema_json, char* err, size_t err_len);
+
+/**
+ * @brief Validates a value.
+ * @param err Receives the first violation, e.g. "$.items[2].qty: must be >= 1" (may be NULL).
+ * @return 0 if the value conforms, -1 otherwise.
+ */
+int json_schema_validate(const JsonSchema* schema, yyjson_val* value, char* err, size_t err_len);
+
+void json_schema_free(JsonSchema* schema);
+
+#endif // JSON_SCHEMA_H
@@ -0,0 +1,87 @@
+#ifndef JSON_TEMPLATE_H
+#define JSON_TEMPLATE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * Precompiled JSON responses: a skeleton written once, with typed
+ * placeholders in value positions:
+ *
+ *   static JsonTemplate* user_tpl;
+ *   user_tpl = json_template_compile(
+ *       "{ \"id\": {{id:int}}, \"name\": {{name:str}}, \"admin\": {{admin:bool}} }");
+ *   ...
+ *   JsonTplValue v[] = { JSON_TPL_INT(id), JSON_TPL_STR(name), JSON_TPL_BOOL(admin) };
+ *   http_send_json_template(conn, 200, user_tpl, v, epollFd);
+ *
+ * Compilation checks the skeleton is valid JSON, strips its insignificant
+ * whitespace and splits it into literal fragments and slots. Rendering
+ * copies the fragments and escapes only the dynamic values; no document tree
+ * is built per request.
+ *
+ * Placeholder types:
+ *   str   JSON string, escaped (NULL renders null)
+ *   int   64-bit signed integer
+ *   num   double (NaN and infinities render null)
+ *   bool  true / false
+ *   raw   already serialized JSON, inserted verbatim (NULL renders null)
+ */
+
+typedef enum {
+    JSON_TPL_SLOT_STR,
+    JSON_TPL_SLOT_INT,
+    JSON_TPL_SLOT_NUM,
+    JSON_TPL_SLOT_BOOL,
+    JSON_TPL_SLOT_RAW,
+} JsonTplSlotType;
+
+// Value for one slot; the slot's type says which member is read
+typedef struct {
+    const char* str;     // str, raw
+    size_t len;
+    long long i;         // int
+    double num;          // num
+    bool b;              // bool
+} JsonTplValue;
+
+#define JSON_TPL_STR(s)       ((JsonTplValue){ .str = (s), .len = (s) ? strlen(s) : 0 })
+#define JSON_TPL_STRN(s, n)   ((JsonTplValue){ .str = (s), .len = (n) })
+#define JSON_TPL_INT(v)       ((JsonTplValue){ .i = (v) })
+#define JSON_TPL_NUM(v)       ((JsonTplValue){ .num = (v) })
+#define JSON_TPL_BOOL(v)      ((JsonTplValue){ .b = (v) })
+#define JSON_TPL_RAW(s)       JSON_TPL_STR(s)
+
+typedef struct JsonTemplate JsonTemplate;
+
+/**
+ * @brief Compiles a skeleton. Meant for startup; logs the reason on failure.
+ * @return The template, or NULL if the skeleton is malformed.
+ */
+JsonTemplate* json_template_compile(const char* skeleton);
+
+void json_template_free(JsonTemplate* tpl);
+
+/**
+ * @brief Number of slots; the values array passed to render has this many entries, in skeleton order.
+ */
+int json_template_slot_count(const JsonTemplate* tpl);
+
+/**
+ * @brief Index of the slot with the given name, or -1.
+ */
+int json_template_slot_index(const JsonTemplate* tpl, const char* name);
+
+/**
+ * @brief Upper bound of the rendered size for these values.
+ */
+size_t json_template_max_size(const JsonTemplate* tpl, const JsonTplValue* values);
+
+/**
+ * @brief Renders into out, which must hold json_template_max_size() bytes.
+ * @return The rendered length (not NUL-terminated).
+ */
+size_t json_template_render(const JsonTemplate* tpl, const JsonTplValue* values, char* out);
+
+#endif // JSON_TEMPLATE_H
@@ -0,0 +1,70 @@
+#ifndef JWT_KEYS_H
+#define JWT_KEYS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+
+// JWS algorithms accepted in the JwtAlgorithm setting
+typedef enum {
+    JWT_ALG_UNKNOWN = 0,
+    JWT_ALG_HS256, JWT_ALG_HS384, JWT_ALG_HS512,
+    JWT_ALG_RS256, JWT_ALG_RS384, JWT_ALG_RS512,
+    JWT_ALG_PS256, JWT_ALG_PS384, JWT_ALG_PS512,
+    JWT_ALG_ES256, JWT_ALG_ES384, JWT_ALG_ES512,
+    JWT_ALG_EDDSA
+} JwtAlgorithm;
+
+/**
+ * @brief Maps a JWS "alg" name (e.g. "ES256") to JwtAlgorithm.
+ * @return JWT_ALG_UNKNOWN for unsupported names.
+ */
+JwtAlgorithm jwt_alg_from_name(const char* name);
+
+/**
+ * @brief True for algorithms verified with a public key (RS*, PS*, ES*, EdDSA).
+ */
+bool jwt_alg_is_asymmetric(JwtAlgorithm alg);
+
+/**
+ * @brief Maps to the matching L8W8JWT_ALG_* constant, for the l8w8jwt fallback.
+ */
+int jwt_alg_to_l8w8jwt(JwtAlgorithm alg);
+
+/**
+ * @brief Loads the public keys named in the configuration (once, at startup).
+ *
+ * JwtPublicKey is a single PEM file (for EdDSA: the key in the format l8w8jwt
+ * expects). JwtJwksFile is a JWKS document whose RSA/EC keys are converted to
+ * PEM and Ed25519 (OKP) keys to hex; entries are selected by "kid".
+ * Any previously loaded keys are discarded.
+ *
+ * @return Number of keys loaded, or -1 on error.
+ */
+int jwt_keys_load(const ServerConfig* config);
+
+/**
+ * @brief Verifies a JWS signature with a loaded key.
+ *
+ * Keys are parsed into mbedtls contexts on first use and cached per thread,
+ * so worker threads never share mutable key state.
+ *
+ * @param alg The token's algorithm.
+ * @param kid The token's "kid" header, or NULL.
+ * @param signing_input "<header>.<payload>" as it appears in the token.
+ * @param sig The decoded signature (raw r||s for ECDSA, as in JWS).
+ * @return 1 if valid, 0 if invalid or no key matches, -1 if this algorithm
+ *         must be verified by l8w8jwt instead (PS*, EdDSA).
+ */
+int jwt_keys_verify(JwtAlgorithm alg, const char* kid,
+                    const unsigned char* signing_input, size_t input_len,
+                    const unsigned char* sig, size_t sig_len);
+
+/**
+ * @brief Returns the key material to hand to l8w8jwt for a token.
+ * @param len_out Receives the key length.
+ * @return The key, or NULL if none matches. Owned by the key store.
+ */
+const unsigned char* jwt_keys_l8w8jwt_key(JwtAlgorithm alg, const char* kid, size_t* len_out);
+
+#endif // JWT_KEYS_H
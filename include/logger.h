@@ -2,6 +2,8 @@
 #define LOGGER_H
 
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 typedef enum {
     LOG_DEBUG,
@@ -31,12 +33,72 @@ void logger_shutdown();
 
 /**
  * Logs a system message with a given level.
- * It works like printf.
+ * It works like printf. Safe to call from worker threads.
  */
 void log_system(LogLevel level, const char* format, ...);
 
+/**
+ * Configures rotation of system.log and access.log (file target only).
+ * Rotated files are renamed to <name>.<YYYYmmdd-HHMMSS>.
+ * @param max_bytes Rotate a file once it reaches this size (0 = no size limit).
+ * @param daily Also rotate both files at local midnight.
+ */
+void logger_set_rotation(size_t max_bytes, bool daily);
+
+/**
+ * Performs any pending rotation. Cheap when nothing is due.
+ * Called by the reactor between event batches, never while a request is being handled.
+ */
+void logger_rotate_if_needed();
+
+/**
+ * Closes and reopens the log files at their configured paths.
+ * Used after an external tool (e.g. logrotate) moved them away; the server
+ * triggers it on SIGUSR1.
+ * @return 0 on success, -1 if a file could not be reopened; logging then
+ *         continues to the old file.
+ */
+int logger_reopen();
+
+/**
+ * State for one rate-limited call site. Use LOG_RATELIMIT_INIT to initialize.
+ */
+typedef struct {
+    unsigned int tokens;
+    long last_refill;          // Monotonic second of the last refill
+    unsigned long suppressed;  // Lines dropped since the last emitted one
+    bool primed;
+} LogRateLimit;
+
+#define LOG_RATELIMIT_INIT { 0, 0, 0, false }
+
+/**
+ * Configures load shedding for the logger.
+ * @param rate_limit Max lines per second for each rate-limited call site (0 = unlimited).
+ * @param access_sample_rate Log 1 in N access lines for non-error responses (0 or 1 = log all).
+ *                           4xx lines share the rate limit, 5xx lines are always logged.
+ */
+void logger_set_limits(unsigned int rate_limit, unsigned int access_sample_rate);
+
+/**
+ * Logs a system message through the given rate limiter.
+ * Dropped lines are counted and reported as "Suppressed N similar messages"
+ * before the next line that gets through. Prefer the log_system_rl() macro.
+ */
+void log_system_ratelimited(LogRateLimit* rl, LogLevel level, const char* format, ...);
+
+/**
+ * Rate-limited log_system() with its own per-call-site limiter.
+ * Use for messages a client can trigger at will (malformed input, attacks).
+ */
+#define log_system_rl(level, ...) do { \
+        static LogRateLimit log_rl_ = LOG_RATELIMIT_INIT; \
+        log_system_ratelimited(&log_rl_, (level), __VA_ARGS__); \
+    } while (0)
+
 /**
  * Logs an access message.
+ * Subject to sampling, see logger_set_limits().
  */
 void log_access(const char* remote_addr, const char* method, const char* uri, int status_code);
 
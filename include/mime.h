@@ -0,0 +1,40 @@
+#ifndef MIME_H
+#define MIME_H
+
+#include <stddef.h>
+#include "config.h"
+
+/**
+ * Content types for static files, keyed by file extension.
+ *
+ * A built-in table covers the common web types. MimeTypesFile can point to
+ * a mime.types file (e.g. /etc/mime.types: "type ext1 ext2 ...", # comments)
+ * whose entries are added on top and override the built-ins. Extensions are
+ * matched case-insensitively through an open-addressing hash table, and every
+ * type carries its ready-made "Content-Type: ...\r\n" header line.
+ */
+
+typedef struct {
+    const char* type;        // e.g. "image/webp"
+    const char* header;      // "Content-Type: image/webp\r\n"
+    size_t header_len;
+} MimeType;
+
+/**
+ * @brief Builds the table from the built-ins and MimeTypesFile. Call again to reload.
+ * @return 0 on success, -1 if MimeTypesFile could not be read (the built-ins are still used).
+ */
+int mime_init(const ServerConfig* config);
+
+/**
+ * @brief Looks up a path's type by the extension of its last component.
+ * @return The type; application/octet-stream if the extension is unknown or missing. Never NULL.
+ */
+const MimeType* mime_lookup(const char* path);
+
+/**
+ * @brief The application/octet-stream entry.
+ */
+const MimeType* mime_default(void);
+
+#endif // MIME_H
@@ -0,0 +1,93 @@
+#ifndef MULTIPART_H
+#define MULTIPART_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "http.h"
+
+/**
+ * Incremental multipart/form-data parser (RFC 7578).
+ *
+ * Input is fed in arbitrary pieces, e.g. straight from a stream handler's
+ * on_body_chunk. Part data is reported as slices of the input (no copies);
+ * the delimiter is located with a Boyer-Moore-Horspool search. Bytes that
+ * might be the start of a delimiter are not consumed, which fits the
+ * on_body_chunk contract: they are offered again with more data behind them.
+ */
+
+#define MULTIPART_BOUNDARY_MAX 70     // RFC 2046
+#define MULTIPART_HEADERS_MAX 8192    // One part's header block
+
+typedef struct {
+    char name[256];          // Content-Disposition name
+    char filename[256];      // Content-Disposition filename, "" for plain fields
+    char content_type[128];  // "" if absent
+    const char* raw_name;    // The name as it appears in the fed input (NULL if absent)
+    size_t raw_name_len;
+} MultipartPart;
+
+typedef struct {
+    // A part starts. Return non-zero to stop parsing.
+    int (*on_part_begin)(void* ctx, const MultipartPart* part);
+    // Next slice of the current part's content. Return non-zero to stop parsing.
+    int (*on_part_data)(void* ctx, const char* data, size_t len);
+    // The current part is complete. Return non-zero to stop parsing.
+    int (*on_part_end)(void* ctx);
+} MultipartCallbacks;
+
+typedef enum {
+    MULTIPART_START,        // Nothing consumed yet: the first delimiter may lack its CRLF
+    MULTIPART_PREAMBLE,     // Before the first delimiter, ignored
+    MULTIPART_AFTER_DELIM,  // "\r\n" (next part) or "--" (end) follows
+    MULTIPART_HEADERS,      // Part header block
+    MULTIPART_DATA,         // Part content
+    MULTIPART_DONE,         // Closing delimiter seen, the epilogue is ignored
+    MULTIPART_ERROR
+} MultipartState;
+
+typedef struct {
+    MultipartState state;
+    char delim[MULTIPART_BOUNDARY_MAX + 4]; // "\r\n--" boundary
+    size_t delim_len;
+    unsigned char skip[256];                // Horspool shift table for delim
+    MultipartPart part;
+} MultipartParser;
+
+/**
+ * @brief Prepares a parser from a request's Content-Type header value.
+ * @return 0 on success, -1 if it is not multipart/form-data with a valid boundary.
+ */
+int multipart_parser_init(MultipartParser* parser, const char* content_type);
+
+/**
+ * @brief Parses the next piece of the body.
+ *
+ * @return Bytes consumed (possibly fewer than len, see above), or -1 if the body
+ *         is malformed or a callback stopped parsing.
+ */
+long multipart_parser_feed(MultipartParser* parser, const char* data, size_t len,
+                           const MultipartCallbacks* cb, void* ctx);
+
+/**
+ * @brief True once the closing delimiter has been parsed.
+ */
+bool multipart_parser_finished(const MultipartParser* parser);
+
+/**
+ * @brief Writes a slice of req->body (e.g. file part data) to out_fd.
+ *
+ * If the body was spilled to a temp file the kernel copies between the files
+ * (copy_file_range) instead of going through the mapping.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int multipart_write_body_slice(const HttpRequest* req, const char* data, size_t len, int out_fd);
+
+/**
+ * @brief Adds the plain (non-file) fields of a complete multipart body to req->body_params.
+ * The body is left intact; the fields are copied to the request's arena.
+ * @return Number of fields added, or -1 if the body is malformed.
+ */
+int multipart_collect_fields(HttpRequest* req, const char* content_type);
+
+#endif // MULTIPART_H
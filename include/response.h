@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include "yyjson.h" // Phase 3: JSON support
+#include "json_template.h"
 
 // Forward declaration to avoid circular dependency
 struct Connection;
@@ -153,6 +154,80 @@ void http_send_error(struct Connection* conn, int status_code, const char* messa
  */
 void http_send_json_doc(struct Connection* conn, int status_code, yyjson_mut_doc* doc, int epollFd);
 
+/**
+ * Send 400 for a JSON body that http_get_json_root() could not parse, e.g.
+ * {"error":"Malformed JSON","message":"unexpected character","position":12}
+ *
+ * @param conn Pointer to Connection
+ * @param epollFd The epoll file descriptor
+ */
+void http_send_json_error(struct Connection* conn, int epollFd);
+
+/**
+ * Send a JSON response rendered from a precompiled template (json_template.h).
+ * The body is rendered straight into the write queue.
+ *
+ * @param conn Pointer to Connection
+ * @param status_code HTTP status code
+ * @param tpl The compiled template
+ * @param values One value per slot, in the template's slot order
+ * @param epollFd The epoll file descriptor
+ */
+void http_send_json_template(struct Connection* conn, int status_code, const JsonTemplate* tpl,
+                             const JsonTplValue* values, int epollFd);
+
+// ============================================================================
+// Streaming Response API (Transfer-Encoding: chunked)
+// ============================================================================
+
+/**
+ * Called once everything queued so far has been written to the socket, so a
+ * producer can generate the next part with bounded memory. Fires once per
+ * http_response_on_drain(). If the connection closes first it is called with
+ * conn == NULL and epollFd == -1 so ctx can be released.
+ */
+typedef void (*ResponseDrainFn)(struct Connection* conn, void* ctx, int epollFd);
+
+/**
+ * Send the status line and headers of a response whose length is not known
+ * up front. The body follows with http_response_write_chunk() and is finished
+ * by http_response_end(); the response may span several event loop iterations.
+ * HTTP/1.0 clients get an unframed body delimited by closing the connection.
+ * Any body set on res is ignored; res can be freed right after this call.
+ *
+ * @return 0 on success, -1 if a response was already started
+ */
+int http_response_begin_chunked(struct Connection* conn, HttpResponse* res, int epollFd);
+
+/**
+ * Queue one chunk of the body. Empty chunks are skipped (a zero-length chunk
+ * would end the body).
+ *
+ * @return 0 on success, -1 if no streaming response is open
+ */
+int http_response_write_chunk(struct Connection* conn, const char* data, size_t len, int epollFd);
+
+/**
+ * Finish a streaming response. The connection then continues with the next
+ * request (keep-alive) or closes, once the queued data has been sent.
+ * A pending drain registration is dropped.
+ *
+ * @return 0 on success, -1 if no streaming response is open
+ */
+int http_response_end(struct Connection* conn, int epollFd);
+
+/**
+ * Ask to be called back when the output queue is empty (see ResponseDrainFn).
+ * Replaces an earlier registration.
+ */
+void http_response_on_drain(struct Connection* conn, ResponseDrainFn fn, void* ctx);
+
+/**
+ * Bytes queued for this connection but not yet written to the socket,
+ * including any part of a mapped static file still to be sent. Producers can stop at a threshold and continue from the drain callback.
+ */
+size_t http_response_pending(const struct Connection* conn);
+
 #endif // RESPONSE_H
 
 
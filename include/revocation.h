@@ -0,0 +1,67 @@
+#ifndef REVOCATION_H
+#define REVOCATION_H
+
+#include <stdbool.h>
+#include <time.h>
+
+/**
+ * @brief Initializes the token revocation set and loads its snapshot.
+ *
+ * Any previous state is discarded. Entries in the snapshot that have
+ * already expired are skipped.
+ *
+ * @param snapshot_path File used to persist revocations across restarts.
+ *                      NULL or "" keeps the set in memory only.
+ * @return 0 on success, -1 if an existing snapshot could not be read.
+ */
+int revocation_init(const char* snapshot_path);
+
+/**
+ * @brief Periodic maintenance: purges expired entries and writes pending
+ * revocations to the snapshot, at most once a minute.
+ *
+ * Called by the reactor between event batches.
+ *
+ * @return Milliseconds until it needs to run again for a pending snapshot
+ *         write (the epoll timeout), or -1 if nothing is pending.
+ */
+int revocation_tick();
+
+/**
+ * @brief Revokes a single token by its 'jti' claim.
+ *
+ * @param jti The token ID.
+ * @param exp The token's expiry. The entry is dropped after this time,
+ *            since the token would be rejected anyway.
+ * Takes effect immediately; the snapshot is written by revocation_tick().
+ * @return 0 on success, -1 on failure.
+ */
+int revocation_add_token_id(const char* jti, time_t exp);
+
+/**
+ * @brief Revokes every token of a user issued before a point in time.
+ *
+ * Used for "log out everywhere", or for tokens that carry no 'jti'.
+ *
+ * @param username The 'sub' claim to match.
+ * @param issued_before Tokens with 'iat' earlier than this (or without 'iat') are revoked.
+ * @param expires When every matching token has expired; the entry is dropped then.
+ * Takes effect immediately; the snapshot is written by revocation_tick().
+ * @return 0 on success, -1 on failure.
+ */
+int revocation_add_user(const char* username, time_t issued_before, time_t expires);
+
+/**
+ * @brief Checks whether a validated token has been revoked.
+ *
+ * Backed by a blocked Bloom filter, so the common "not revoked" answer
+ * costs two cache-line probes; only filter hits consult the exact set.
+ *
+ * @param jti The token's 'jti' claim, or NULL if it has none.
+ * @param username The token's 'sub' claim.
+ * @param iat The token's 'iat' claim, or 0 if it has none.
+ * @return true if the token must be rejected.
+ */
+bool revocation_is_revoked(const char* jti, const char* username, time_t iat);
+
+#endif // REVOCATION_H
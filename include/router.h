@@ -7,6 +7,52 @@
 // Handler function pointer type for API routes
 typedef void (*RouteHandler)(Connection* conn, ServerConfig* config, int epollFd);
 
+// Declarative per-route checks, run by the server as soon as the request
+// headers are complete: before the body is read and before any parameter or
+// JSON parsing. Rejected requests never reach the handler.
+typedef struct {
+    bool auth_required;  // 401 unless the request carries a valid Bearer token
+    const char* roles;   // Comma-separated, the user needs at least one (403 otherwise).
+                         // NULL = any authenticated user. Implies auth_required.
+    size_t max_body_size; // 413 above this many bytes, 0 = the server's MaxBodySize
+    const char* json_schema; // JSON Schema subset (see json_schema.h) the JSON body must
+                             // match, checked once the body is complete (400 otherwise).
+                             // Compiled at registration. Ignored for streaming routes.
+} RouteOptions;
+
+/**
+ * Streaming request handler: the body is handed over piece by piece as it
+ * arrives instead of being buffered, so memory stays bounded regardless of
+ * the upload size. Per-request state can be kept in conn->request.stream_ctx.
+ */
+typedef struct {
+    // Headers complete (and route middleware passed), before any body byte.
+    // Return 0 to accept the body, or an HTTP status (e.g. 415) to reject it. Optional.
+    int (*on_headers)(Connection* conn, ServerConfig* config, int epollFd);
+
+    // Next piece of the body. Return the number of bytes consumed (0..len).
+    // Unconsumed bytes are offered again later; while the buffer is full the
+    // server stops reading from the socket (backpressure) until more is
+    // consumed or server_resume_reading() is called.
+    // Return a negative HTTP status (e.g. -500) to abort with that response.
+    long (*on_body_chunk)(Connection* conn, const char* data, size_t len);
+
+    // The whole body has been delivered. Must send the response, like a RouteHandler.
+    void (*on_complete)(Connection* conn, ServerConfig* config, int epollFd);
+
+    // The request ended without on_complete (disconnect, abort). Optional.
+    void (*on_abort)(Connection* conn);
+} StreamHandler;
+
+typedef struct Route {
+    char* method;
+    char* path;
+    RouteHandler handler;  // NULL for streaming routes
+    StreamHandler stream;  // on_complete != NULL for streaming routes
+    RouteOptions options;  // roles is an owned copy, json_schema is not kept
+    struct JsonSchema* schema; // Compiled options.json_schema, NULL = no body validation
+} Route;
+
 /**
  * @brief Initializes the router system. Should be called once at startup.
  */
@@ -21,8 +67,45 @@ void router_init();
  * @param method The HTTP method (e.g., "GET", "POST").
  * @param path The URL path (e.g., "/api/login").
  * @param handler The function pointer to handle requests for this route.
+ * @return 0 on success, -1 if the route was not added (the caller should abort startup).
+ */
+int router_add_route(const char* method, const char* path, RouteHandler handler);
+
+/**
+ * @brief Adds a route with middleware options (see RouteOptions).
+ *
+ * On success the handler finds the authenticated user in
+ * conn->request.authed_user and the token's roles in conn->request.auth_roles.
+ *
+ * @param options May be NULL, which is the same as router_add_route().
+ * @return 0 on success, -1 if the route was not added, e.g. because its
+ *         json_schema does not compile.
+ */
+int router_add_route_ex(const char* method, const char* path, RouteHandler handler, const RouteOptions* options);
+
+/**
+ * @brief Adds a route whose request body is streamed to the handler (see StreamHandler).
+ *
+ * @param stream The callbacks; on_body_chunk and on_complete are required.
+ * @param options May be NULL.
+ * @return 0 on success, -1 if the route was not added.
+ */
+int router_add_stream_route(const char* method, const char* path, const StreamHandler* stream,
+                            const RouteOptions* options);
+
+/**
+ * @brief Number of route registrations that failed since router_init().
+ *
+ * startServer() refuses to start while this is non-zero, since a missing
+ * route would fall through to the static file handler.
+ */
+int router_failed_count();
+
+/**
+ * @brief Finds the route for a given method and path.
+ * @return The matched route, or NULL if no route matches.
  */
-void router_add_route(const char* method, const char* path, RouteHandler handler);
+const Route* router_find_route(const char* method, const char* path);
 
 /**
  * @brief Finds a handler for a given method and path.
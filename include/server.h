@@ -3,9 +3,11 @@
 
 #include <netinet/in.h> // For INET_ADDRSTRLEN
 #include <stddef.h> // For size_t
+#include "config.h"
 
 // Forward declaration of Connection struct to avoid circular dependency
 struct Connection;
+struct FileMapping;
 
 /**
  * @brief Starts the web server.
@@ -24,5 +26,56 @@ void startServer(const char* configFilePath);
  */
 void queue_data_for_writing(struct Connection* conn, const char* data, size_t len, int epollFd);
 
+/**
+ * @brief Reserves `len` bytes at the end of the write queue for the caller to fill in place.
+ *
+ * Nothing is queued until queue_commit_for_writing(). The pointer is only
+ * valid until the next call that queues or reserves data.
+ *
+ * @return The reserved space, or NULL if out of memory.
+ */
+char* queue_reserve_for_writing(struct Connection* conn, size_t len);
+
+/**
+ * @brief Queues `len` bytes filled in at offset `skip` of the reserved space.
+ *
+ * The skipped bytes are not sent. When nothing else is pending the queue
+ * simply starts at the data; otherwise the data is moved down.
+ */
+void queue_commit_for_writing(struct Connection* conn, size_t skip, size_t len, int epollFd);
+
+/**
+ * @brief Queues bytes [offset, offset + len) of a shared file mapping, sent without copying.
+ *
+ * Takes over the caller's reference (released once sent or on close). Must be
+ * the last thing queued for the response: nothing may be queued after it.
+ */
+void queue_mapping_for_writing(struct Connection* conn, struct FileMapping* map, size_t offset, size_t len, int epollFd);
+
+/**
+ * @brief Resumes reading a streamed request body after backpressure.
+ *
+ * Call when a stream handler that returned less than it was offered is ready
+ * for more data. The buffered bytes are offered again and reading continues.
+ */
+void server_resume_reading(struct Connection* conn, ServerConfig* config, int epollFd);
+
+/**
+ * @brief Marks the start of asynchronous work that will call back into a connection.
+ *
+ * Until the matching server_async_end(), the request stays in place (body
+ * included), no further input is read, and a disconnect only closes the socket:
+ * the Connection itself is kept so the completion can find it.
+ */
+void server_async_begin(struct Connection* conn);
+
+/**
+ * @brief Marks the end of asynchronous work started with server_async_begin().
+ * Must be called on the reactor thread, before touching the connection.
+ * @return 0 if the connection is still open, -1 if the client disconnected
+ *         (the connection has been freed and must not be used).
+ */
+int server_async_end(struct Connection* conn);
+
 
 #endif // SERVER_H 
\ No newline at end of file
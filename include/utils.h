@@ -12,10 +12,18 @@
  */
 char* urlDecode(const char* str);
 
+/**
+ * @brief Decodes a URL-encoded string in place ('+' and %XX; invalid escapes are kept).
+ * @param str The string to decode; str[len] receives the new terminator.
+ * @param len Length of the encoded string.
+ * @return The decoded length.
+ */
+size_t urlDecodeInPlace(char* str, size_t len);
+
 /**
  * @brief Determines the MIME type of a file based on its extension.
  * @param path The path to the file.
- * @return A string literal representing the MIME type. 
+ * @return The MIME type (see mime.h; valid until the table is reloaded).
  *         Defaults to "application/octet-stream" if the type is unknown.
  */
 const char* getMimeType(const char* path);
@@ -37,20 +45,27 @@ char* get_query_param(const char* str, const char* key);
 
 /**
  * @brief Parse all parameters from a URL-encoded string into a QueryParam array.
- * 
- * @param str The URL-encoded string (e.g., "key1=val1&key2=val2").
+ *
+ * Nothing is allocated: `str` is split and decoded in place, and the keys and
+ * values point into it. str[len] must be writable (normally the terminator).
+ *
+ * @param str The URL-encoded string (e.g., "key1=val1&key2=val2"), modified.
+ * @param len Length of the string.
  * @param params Output array of QueryParam structs.
  * @param max_params Maximum number of parameters to parse.
  * @return Number of parameters parsed.
  */
-int parse_params(const char* str, void* params, int max_params);
+int parse_params(char* str, size_t len, QueryParam* params, int max_params);
 
 /**
  * @brief Parse query string and body parameters from an HttpRequest.
- * 
- * This should be called after the request is fully parsed.
- * It will populate query_params[] and body_params[] in the request.
- * 
+ *
+ * Not needed normally: the getters below and http_get_json_root() parse what
+ * they need on first use. This forces everything, e.g. before handing the
+ * request to code that reads query_params[] / body_params[] / json_root directly.
+ * A form body is decoded in place, so afterwards req->body no longer holds
+ * the raw bytes.
+ *
  * @param req Pointer to the HttpRequest.
  */
 void http_parse_all_params(HttpRequest* req);
@@ -60,12 +75,13 @@ void http_parse_all_params(HttpRequest* req);
  * 
  * Unlike get_query_param(), this does NOT allocate new memory.
  * The returned pointer is valid as long as the HttpRequest is valid.
+ * The parameters are parsed on the first lookup.
  * 
  * @param req Pointer to the HttpRequest.
  * @param key The parameter key to look for.
  * @return Pointer to the value string, or NULL if not found.
  */
-const char* http_get_param(const HttpRequest* req, const char* key);
+const char* http_get_param(HttpRequest* req, const char* key);
 
 /**
  * @brief Get a parameter value from query_params only.
@@ -74,15 +90,31 @@ const char* http_get_param(const HttpRequest* req, const char* key);
  * @param key The parameter key to look for.
  * @return Pointer to the value string, or NULL if not found.
  */
-const char* http_get_query_param(const HttpRequest* req, const char* key);
+const char* http_get_query_param(HttpRequest* req, const char* key);
 
 /**
  * @brief Get a parameter value from body_params only.
+ *
+ * Form bodies are decoded in place on the first call (see parse_params).
+ * Returns NULL until the body is complete, e.g. in a stream handler.
  * 
  * @param req Pointer to the HttpRequest.
  * @param key The parameter key to look for.
  * @return Pointer to the value string, or NULL if not found.
  */
-const char* http_get_body_param(const HttpRequest* req, const char* key);
+const char* http_get_body_param(HttpRequest* req, const char* key);
+
+/**
+ * @brief Get the root of the JSON body (Content-Type: application/json).
+ *
+ * The body is parsed on the first call; the document lives until the request
+ * is freed. It is parsed in situ when the buffer allows, so afterwards
+ * req->body may no longer hold the raw bytes. If the body is malformed,
+ * req->json_err tells where (see http_send_json_error()).
+ *
+ * @param req Pointer to the HttpRequest.
+ * @return The root value, or NULL if there is no JSON body or it is malformed.
+ */
+yyjson_val* http_get_json_root(HttpRequest* req);
 
 #endif // UTILS_H 
\ No newline at end of file
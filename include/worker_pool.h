@@ -0,0 +1,57 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+/**
+ * A small thread pool for CPU-heavy work (e.g. RSA/ECDSA signature checks)
+ * that must not block the reactor thread.
+ *
+ * Jobs run on a worker thread; their completion callbacks run back on the
+ * reactor thread, which is woken through an eventfd registered with epoll.
+ */
+
+// Runs on a worker thread. Must not touch reactor-owned state.
+typedef void (*WorkerJobFn)(void* arg);
+
+// Runs on the reactor thread once the job has finished.
+typedef void (*WorkerDoneFn)(void* arg);
+
+/**
+ * @brief Starts the worker threads.
+ * @param thread_count Number of threads. 0 leaves the pool disabled.
+ * @return 0 on success, -1 on failure.
+ */
+int worker_pool_init(int thread_count);
+
+/**
+ * @brief Returns true if the pool has running threads.
+ */
+int worker_pool_enabled();
+
+/**
+ * @brief Queues a job.
+ * @param job Work to run on a worker thread.
+ * @param done Completion to run on the reactor thread (may be NULL).
+ * @param arg Passed to both callbacks.
+ * @return 0 on success, -1 if the pool is disabled or out of memory.
+ */
+int worker_pool_submit(WorkerJobFn job, WorkerDoneFn done, void* arg);
+
+/**
+ * @brief The eventfd that becomes readable when completions are pending.
+ * @return The file descriptor, or -1 if the pool is disabled.
+ */
+int worker_pool_event_fd();
+
+/**
+ * @brief Runs the completion callbacks of all finished jobs.
+ * Must be called on the reactor thread when worker_pool_event_fd() is readable.
+ */
+void worker_pool_run_completions();
+
+/**
+ * @brief Stops the threads after the queued jobs have finished.
+ * Completions that were not yet run are discarded.
+ */
+void worker_pool_shutdown();
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,135 @@
+#include "arena.h"
+#include "logger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+
+#define ARENA_ALIGN alignof(max_align_t)
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+struct ArenaChunk {
+    ArenaChunk* next;
+    size_t size;
+    size_t used;
+    alignas(max_align_t) char data[];
+};
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = size ? ALIGN_UP(size) : ARENA_ALIGN;
+    ArenaChunk* chunk = arena->current;
+    while (chunk) {
+        if (chunk->size - chunk->used >= size) {
+            void* p = chunk->data + chunk->used;
+            chunk->used += size;
+            arena->current = chunk;
+            return p;
+        }
+        if (!chunk->next) break;
+        // Recycled from an earlier request
+        chunk = chunk->next;
+        chunk->used = 0;
+    }
+
+    size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+    ArenaChunk* fresh = malloc(sizeof(ArenaChunk) + chunk_size);
+    if (!fresh) {
+        log_system_rl(LOG_ERROR, "Arena: Out of memory allocating %zu bytes.", chunk_size);
+        return NULL;
+    }
+    fresh->next = NULL;
+    fresh->size = chunk_size;
+    fresh->used = size;
+    if (chunk) {
+        chunk->next = fresh;
+    } else {
+        arena->first = fresh;
+    }
+    arena->current = fresh;
+    arena->capacity += chunk_size;
+    return fresh->data;
+}
+
+char* arena_strndup(Arena* arena, const char* str, size_t len) {
+    char* copy = arena_alloc(arena, len + 1);
+    if (copy) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+char* arena_strdup(Arena* arena, const char* str) {
+    return str ? arena_strndup(arena, str, strlen(str)) : NULL;
+}
+
+void arena_reset(Arena* arena) {
+    if (!arena->first) return;
+    if (arena->capacity > ARENA_KEEP_MAX) {
+        // A large request: give the extra chunks back
+        ArenaChunk* chunk = arena->first->next;
+        while (chunk) {
+            ArenaChunk* next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+        arena->first->next = NULL;
+        arena->capacity = arena->first->size;
+        if (arena->capacity > ARENA_KEEP_MAX) {
+            free(arena->first);
+            arena->first = NULL;
+            arena->capacity = 0;
+        }
+    }
+    arena->current = arena->first;
+    if (arena->first) {
+        arena->first->used = 0;
+    }
+}
+
+void arena_destroy(Arena* arena) {
+    ArenaChunk* chunk = arena->first;
+    while (chunk) {
+        ArenaChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    memset(arena, 0, sizeof(*arena));
+}
+
+// yyjson allocator callbacks
+static void* alc_malloc(void* ctx, size_t size) {
+    return arena_alloc(ctx, size);
+}
+
+static void* alc_realloc(void* ctx, void* ptr, size_t old_size, size_t size) {
+    Arena* arena = ctx;
+    ArenaChunk* chunk = arena->current;
+    if (ptr && chunk && (char*)ptr + ALIGN_UP(old_size) == chunk->data + chunk->used) {
+        // The last allocation: grow or shrink it in place if the chunk allows
+        size_t offset = (char*)ptr - chunk->data;
+        if (offset + ALIGN_UP(size) <= chunk->size) {
+            chunk->used = offset + ALIGN_UP(size);
+            return ptr;
+        }
+    }
+    void* p = arena_alloc(arena, size);
+    if (p && ptr) {
+        memcpy(p, ptr, old_size < size ? old_size : size);
+    }
+    return p;
+}
+
+static void alc_free(void* ctx, void* ptr) {
+    (void)ctx;
+    (void)ptr; // Released by arena_reset()
+}
+
+const yyjson_alc* arena_yyjson_alc(Arena* arena) {
+    if (!arena->alc.ctx) {
+        arena->alc.malloc = alc_malloc;
+        arena->alc.realloc = alc_realloc;
+        arena->alc.free = alc_free;
+        arena->alc.ctx = arena;
+    }
+    return &arena->alc;
+}
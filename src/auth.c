@@ -7,9 +7,612 @@
 #include <l8w8jwt/encode.h> // Required for encoding functions
 #include "logger.h"
 #include <time.h> // Required for time()
+#include <stdint.h>
+#include <stdbool.h>
+#include <mbedtls/sha256.h> // HMAC midstates for the native HS256 verifier (bundled with l8w8jwt)
+#include <stdio.h>
+#include <sys/random.h> // For getrandom (jti generation)
+#include "revocation.h"
+#include "jwt_keys.h"
+#include "worker_pool.h"
+#include "server.h" // For server_async_begin/end
 
-char* authenticate_request(Connection* conn, ServerConfig* config) {
-    // 1. Find the Authorization header
+#define JWT_LIFETIME_SECONDS (15 * 60)
+
+// The claims we act on, extracted once per token by either verifier
+typedef struct {
+    char* sub;
+    char* jti;   // NULL if absent
+    char* roles; // Comma-separated "roles" claim, NULL if absent
+    time_t exp;  // 0 if absent
+    time_t iat;  // 0 if absent
+} JwtClaims;
+
+static void jwt_claims_free(JwtClaims* claims) {
+    free(claims->sub);
+    free(claims->jti);
+    free(claims->roles);
+    memset(claims, 0, sizeof(*claims));
+}
+
+// ============================================================================
+// Validated-token cache
+// ============================================================================
+// Clients reuse the same JWT for every request until it expires, so we remember
+// tokens that already passed full verification. A hit costs one hash plus a
+// constant-time comparison of the full token, instead of base64 decoding,
+// claim parsing and HMAC. The reactor is single-threaded, so no locking.
+
+#define JWT_CACHE_SLOTS 1024 // Must be a power of two
+#define JWT_CACHE_MAX_TOKEN_LEN 2048
+
+typedef struct {
+    uint64_t hash;
+    char* token;        // Full token copy for the hit comparison (NULL = empty slot)
+    size_t token_len;
+    JwtClaims claims;   // Decoded claims, entry is evicted once claims.exp is reached
+} JwtCacheEntry;
+
+static JwtCacheEntry jwt_cache[JWT_CACHE_SLOTS];
+
+// FNV-1a, 64-bit
+static uint64_t hash_token(const char* token, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)token[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Compares every byte regardless of where the first difference is
+static int constant_time_equals(const char* a, const char* b, size_t len) {
+    unsigned char diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff |= (unsigned char)a[i] ^ (unsigned char)b[i];
+    }
+    return diff == 0;
+}
+
+static void jwt_cache_evict(JwtCacheEntry* entry) {
+    free(entry->token);
+    jwt_claims_free(&entry->claims);
+    memset(entry, 0, sizeof(*entry));
+}
+
+// Returns the cached claims of a still-valid token, or NULL on a miss.
+static const JwtClaims* jwt_cache_lookup(const char* token, size_t len, uint64_t hash, time_t now) {
+    JwtCacheEntry* entry = &jwt_cache[hash & (JWT_CACHE_SLOTS - 1)];
+    if (!entry->token || entry->hash != hash || entry->token_len != len) {
+        return NULL;
+    }
+    if (!constant_time_equals(entry->token, token, len)) {
+        return NULL;
+    }
+    if (now >= entry->claims.exp) {
+        jwt_cache_evict(entry);
+        return NULL;
+    }
+    return &entry->claims;
+}
+
+// Takes ownership of *claims (which is cleared) if the token is cached.
+static void jwt_cache_insert(const char* token, size_t len, uint64_t hash, JwtClaims* claims) {
+    if (len > JWT_CACHE_MAX_TOKEN_LEN) {
+        return;
+    }
+    JwtCacheEntry* entry = &jwt_cache[hash & (JWT_CACHE_SLOTS - 1)];
+    jwt_cache_evict(entry); // Direct-mapped: the newest token wins the slot
+
+    entry->token = strndup(token, len);
+    if (!entry->token) {
+        return;
+    }
+    entry->hash = hash;
+    entry->token_len = len;
+    entry->claims = *claims;
+    memset(claims, 0, sizeof(*claims));
+}
+
+// ============================================================================
+// Native verifier
+// ============================================================================
+// l8w8jwt parses every claim into heap-allocated arrays, re-derives the HMAC
+// key pads and re-parses public keys on each call. Instead, for HS256 we keep
+// the SHA-256 states after absorbing key^ipad and key^opad (computed once by
+// auth_init()), RS*/ES* signatures are checked against keys parsed once per
+// thread (jwt_keys.c), and only sub/exp/nbf/iat/jti are read, with yyjson
+// backed by a stack pool. Tokens this path cannot handle fall back to l8w8jwt.
+//
+// Everything in this section is safe to run on worker threads: it only reads
+// state built by auth_init() and never touches the cache or revocation set.
+
+#define JWT_NATIVE_MAX_HEADER 256    // Decoded header bytes
+#define JWT_NATIVE_MAX_PAYLOAD 1024  // Decoded payload bytes
+#define JWT_NATIVE_MAX_SIGNATURE 1024 // Decoded signature bytes (RSA-8192)
+#define JWT_KID_MAX 128
+#define SHA256_BLOCK_SIZE 64
+#define SHA256_DIGEST_SIZE 32
+
+typedef enum {
+    JWT_NATIVE_VALID,
+    JWT_NATIVE_INVALID,
+    JWT_NATIVE_UNSUPPORTED  // Too large or unusual, let l8w8jwt decide
+} JwtNativeResult;
+
+static struct {
+    bool ready;
+    mbedtls_sha256_context inner;  // State after key ^ ipad
+    mbedtls_sha256_context outer;  // State after key ^ opad
+} hs256_key;
+
+// The only algorithm accepted in token headers (JwtAlgorithm)
+static JwtAlgorithm auth_alg = JWT_ALG_HS256;
+
+// JwtMaxTokenLifetime: user-wide revocations must outlive every token they cover
+static time_t max_token_lifetime = 24 * 60 * 60;
+
+void auth_init(const ServerConfig* config) {
+    revocation_init(config->revocation_snapshot);
+    max_token_lifetime = config->jwt_max_token_lifetime;
+
+    if (hs256_key.ready) {
+        mbedtls_sha256_free(&hs256_key.inner);
+        mbedtls_sha256_free(&hs256_key.outer);
+        hs256_key.ready = false;
+    }
+    if (!config->jwt_enabled) {
+        return;
+    }
+
+    auth_alg = jwt_alg_from_name(config->jwt_algorithm);
+    if (auth_alg == JWT_ALG_UNKNOWN) {
+        log_system(LOG_ERROR, "Auth: Unsupported JwtAlgorithm '%s', all tokens will be rejected.", config->jwt_algorithm);
+        return;
+    }
+    if (jwt_alg_is_asymmetric(auth_alg)) {
+        if (jwt_keys_load(config) <= 0) {
+            log_system(LOG_ERROR, "Auth: No public keys for %s, all tokens will be rejected.", config->jwt_algorithm);
+        }
+        return;
+    }
+    if (auth_alg != JWT_ALG_HS256) {
+        return; // HS384/HS512 are verified by l8w8jwt
+    }
+
+    // HMAC key block: keys longer than the block size are hashed first
+    unsigned char key_block[SHA256_BLOCK_SIZE] = {0};
+    size_t key_len = strlen(config->jwt_secret);
+    if (key_len > SHA256_BLOCK_SIZE) {
+        mbedtls_sha256((const unsigned char*)config->jwt_secret, key_len, key_block, 0);
+    } else {
+        memcpy(key_block, config->jwt_secret, key_len);
+    }
+
+    unsigned char ipad[SHA256_BLOCK_SIZE];
+    unsigned char opad[SHA256_BLOCK_SIZE];
+    for (int i = 0; i < SHA256_BLOCK_SIZE; i++) {
+        ipad[i] = key_block[i] ^ 0x36;
+        opad[i] = key_block[i] ^ 0x5c;
+    }
+
+    mbedtls_sha256_init(&hs256_key.inner);
+    mbedtls_sha256_starts(&hs256_key.inner, 0);
+    mbedtls_sha256_update(&hs256_key.inner, ipad, sizeof(ipad));
+
+    mbedtls_sha256_init(&hs256_key.outer);
+    mbedtls_sha256_starts(&hs256_key.outer, 0);
+    mbedtls_sha256_update(&hs256_key.outer, opad, sizeof(opad));
+
+    memset(key_block, 0, sizeof(key_block));
+    memset(ipad, 0, sizeof(ipad));
+    memset(opad, 0, sizeof(opad));
+    hs256_key.ready = true;
+    log_system(LOG_DEBUG, "Auth: Precomputed HS256 key state.");
+}
+
+static int base64url_value(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '-') return 62;
+    if (c == '_') return 63;
+    return -1;
+}
+
+// Decodes unpadded base64url. Returns the decoded length, or -1 on bad input/overflow.
+static long base64url_decode(const char* in, size_t len, unsigned char* out, size_t out_size) {
+    size_t out_len = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    if (len % 4 == 1) return -1;
+    for (size_t i = 0; i < len; i++) {
+        int v = base64url_value((unsigned char)in[i]);
+        if (v < 0) return -1;
+        acc = (acc << 6) | (uint32_t)v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (out_len >= out_size) return -1;
+            out[out_len++] = (unsigned char)(acc >> bits);
+        }
+    }
+    return (long)out_len;
+}
+
+// The "roles" claim may be an array of strings or a single comma-separated
+// string. Returns a malloc'd comma-separated list, or NULL.
+static char* roles_from_json(yyjson_val* val) {
+    if (yyjson_is_str(val)) {
+        return strdup(yyjson_get_str(val));
+    }
+    if (!yyjson_is_arr(val)) {
+        return NULL;
+    }
+
+    size_t len = 0, idx, max;
+    yyjson_val* role;
+    yyjson_arr_foreach(val, idx, max, role) {
+        if (yyjson_is_str(role)) len += yyjson_get_len(role) + 1;
+    }
+    char* roles = len ? malloc(len) : NULL;
+    if (!roles) return NULL;
+
+    char* p = roles;
+    yyjson_arr_foreach(val, idx, max, role) {
+        if (!yyjson_is_str(role)) continue;
+        if (p != roles) *p++ = ',';
+        memcpy(p, yyjson_get_str(role), yyjson_get_len(role));
+        p += yyjson_get_len(role);
+    }
+    *p = '\0';
+    return roles;
+}
+
+// Reads a NumericDate claim. Returns 0 if absent, -1 if present but not a number.
+static int read_numeric_date(yyjson_val* root, const char* key, time_t* out) {
+    yyjson_val* val = yyjson_obj_get(root, key);
+    if (!val) return 0;
+    if (yyjson_is_int(val)) {
+        *out = (time_t)yyjson_get_sint(val);
+    } else if (yyjson_is_real(val)) {
+        *out = (time_t)yyjson_get_real(val);
+    } else {
+        return -1;
+    }
+    return 1;
+}
+
+// Checks HMAC-SHA256 over "header.payload", resuming from the precomputed pads.
+static JwtNativeResult hs256_check(const char* signing_input, size_t input_len,
+                                   const unsigned char* sig, long sig_len) {
+    if (!hs256_key.ready) return JWT_NATIVE_UNSUPPORTED;
+
+    unsigned char inner_hash[SHA256_DIGEST_SIZE];
+    unsigned char mac[SHA256_DIGEST_SIZE];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_clone(&ctx, &hs256_key.inner);
+    mbedtls_sha256_update(&ctx, (const unsigned char*)signing_input, input_len);
+    mbedtls_sha256_finish(&ctx, inner_hash);
+    mbedtls_sha256_clone(&ctx, &hs256_key.outer);
+    mbedtls_sha256_update(&ctx, inner_hash, sizeof(inner_hash));
+    mbedtls_sha256_finish(&ctx, mac);
+    mbedtls_sha256_free(&ctx);
+
+    if (sig_len != SHA256_DIGEST_SIZE ||
+        !constant_time_equals((const char*)sig, (const char*)mac, SHA256_DIGEST_SIZE)) {
+        return JWT_NATIVE_INVALID;
+    }
+    return JWT_NATIVE_VALID;
+}
+
+// kid_out (JWT_KID_MAX bytes) receives the header's "kid", for the l8w8jwt fallback.
+static JwtNativeResult jwt_verify_native(const char* token, size_t token_len, time_t now,
+                                         JwtClaims* claims_out, char* kid_out) {
+    kid_out[0] = '\0';
+    if (auth_alg == JWT_ALG_UNKNOWN) return JWT_NATIVE_INVALID;
+
+    // 1. Split header.payload.signature
+    const char* dot1 = memchr(token, '.', token_len);
+    if (!dot1) return JWT_NATIVE_INVALID;
+    const char* dot2 = memchr(dot1 + 1, '.', token_len - (dot1 + 1 - token));
+    if (!dot2) return JWT_NATIVE_INVALID;
+    const char* sig = dot2 + 1;
+    size_t sig_len = token_len - (sig - token);
+    if (memchr(sig, '.', sig_len)) return JWT_NATIVE_INVALID;
+
+    // 2. Header must name the configured algorithm (also rejects "none" and algorithm confusion)
+    char header[JWT_NATIVE_MAX_HEADER + YYJSON_PADDING_SIZE];
+    long header_len = base64url_decode(token, dot1 - token, (unsigned char*)header, JWT_NATIVE_MAX_HEADER);
+    if (header_len < 0) return JWT_NATIVE_UNSUPPORTED;
+    memset(header + header_len, 0, YYJSON_PADDING_SIZE);
+
+    // Big enough for yyjson_read_max_memory_usage(JWT_NATIVE_MAX_PAYLOAD, YYJSON_READ_INSITU)
+    char pool_buf[16384];
+    yyjson_alc pool;
+    yyjson_alc_pool_init(&pool, pool_buf, sizeof(pool_buf));
+
+    yyjson_doc* doc = yyjson_read_opts(header, header_len, YYJSON_READ_INSITU, &pool, NULL);
+    if (!doc) return JWT_NATIVE_INVALID;
+    yyjson_val* header_root = yyjson_doc_get_root(doc);
+    JwtAlgorithm alg = jwt_alg_from_name(yyjson_get_str(yyjson_obj_get(header_root, "alg")));
+    const char* kid = yyjson_get_str(yyjson_obj_get(header_root, "kid"));
+    if (kid) snprintf(kid_out, JWT_KID_MAX, "%s", kid);
+    yyjson_doc_free(doc);
+    if (alg != auth_alg) return JWT_NATIVE_INVALID;
+
+    // 3. Signature
+    unsigned char sig_bytes[JWT_NATIVE_MAX_SIGNATURE];
+    long sig_bytes_len = base64url_decode(sig, sig_len, sig_bytes, sizeof(sig_bytes));
+    if (sig_bytes_len < 0) return JWT_NATIVE_INVALID;
+
+    JwtNativeResult checked;
+    if (alg == JWT_ALG_HS256) {
+        checked = hs256_check(token, dot2 - token, sig_bytes, sig_bytes_len);
+    } else if (jwt_alg_is_asymmetric(alg)) {
+        int r = jwt_keys_verify(alg, kid_out[0] ? kid_out : NULL, (const unsigned char*)token, dot2 - token,
+                                sig_bytes, sig_bytes_len);
+        checked = r < 0 ? JWT_NATIVE_UNSUPPORTED : (r ? JWT_NATIVE_VALID : JWT_NATIVE_INVALID);
+    } else {
+        checked = JWT_NATIVE_UNSUPPORTED;
+    }
+    if (checked != JWT_NATIVE_VALID) return checked;
+
+    // 4. Claims: only sub, exp, nbf, iat and jti matter to us
+    char payload[JWT_NATIVE_MAX_PAYLOAD + YYJSON_PADDING_SIZE];
+    long payload_len = base64url_decode(dot1 + 1, dot2 - dot1 - 1, (unsigned char*)payload, JWT_NATIVE_MAX_PAYLOAD);
+    if (payload_len < 0) return JWT_NATIVE_UNSUPPORTED;
+    memset(payload + payload_len, 0, YYJSON_PADDING_SIZE);
+
+    yyjson_alc_pool_init(&pool, pool_buf, sizeof(pool_buf));
+    doc = yyjson_read_opts(payload, payload_len, YYJSON_READ_INSITU, &pool, NULL);
+    if (!doc) return JWT_NATIVE_UNSUPPORTED;
+    yyjson_val* root = yyjson_doc_get_root(doc);
+    if (!yyjson_is_obj(root)) {
+        yyjson_doc_free(doc);
+        return JWT_NATIVE_INVALID;
+    }
+
+    JwtNativeResult result = JWT_NATIVE_VALID;
+    time_t exp = 0, nbf = 0, iat = 0;
+    const char* sub = yyjson_get_str(yyjson_obj_get(root, "sub"));
+    const char* jti = yyjson_get_str(yyjson_obj_get(root, "jti"));
+    if (read_numeric_date(root, "exp", &exp) != 1 || now >= exp) {
+        result = JWT_NATIVE_INVALID; // exp is mandatory, as with validate_exp in l8w8jwt
+    } else if (read_numeric_date(root, "nbf", &nbf) < 0 || now < nbf) {
+        result = JWT_NATIVE_INVALID;
+    } else if (read_numeric_date(root, "iat", &iat) < 0) {
+        result = JWT_NATIVE_INVALID;
+    } else if (!sub) {
+        log_system_rl(LOG_WARNING, "JWT is valid, but 'sub' claim is missing or not a string.");
+        result = JWT_NATIVE_INVALID;
+    } else {
+        claims_out->sub = strdup(sub);
+        claims_out->jti = jti ? strdup(jti) : NULL;
+        claims_out->roles = roles_from_json(yyjson_obj_get(root, "roles"));
+        claims_out->exp = exp;
+        claims_out->iat = iat;
+        if (!claims_out->sub || (jti && !claims_out->jti)) {
+            jwt_claims_free(claims_out);
+            result = JWT_NATIVE_INVALID;
+        }
+    }
+    yyjson_doc_free(doc);
+
+    if (result == JWT_NATIVE_VALID) {
+        log_system(LOG_DEBUG, "Auth: JWT validation successful for user '%s'.", claims_out->sub);
+    }
+    return result;
+}
+
+// Full l8w8jwt decode, used when the native verifier cannot handle a token.
+// Returns 0 and fills *claims_out on success.
+static int jwt_verify_l8w8jwt(const char* token, size_t token_len, const char* kid,
+                              const ServerConfig* config, JwtClaims* claims_out) {
+    int result = -1;
+    struct l8w8jwt_decoding_params params;
+    l8w8jwt_decoding_params_init(&params);
+    params.alg = jwt_alg_to_l8w8jwt(auth_alg);
+    params.jwt = (char*)token;
+    params.jwt_length = token_len;
+    if (jwt_alg_is_asymmetric(auth_alg)) {
+        size_t key_len = 0;
+        const unsigned char* key = jwt_keys_l8w8jwt_key(auth_alg, kid[0] ? kid : NULL, &key_len);
+        if (!key) {
+            log_system_rl(LOG_INFO, "JWT validation failed: no public key for kid '%s'.", kid);
+            return -1;
+        }
+        params.verification_key = (unsigned char*)key;
+        params.verification_key_length = key_len;
+    } else {
+        params.verification_key = (unsigned char*)config->jwt_secret;
+        params.verification_key_length = strlen(config->jwt_secret);
+    }
+    params.validate_exp = 1;
+
+    enum l8w8jwt_validation_result validation_result;
+    struct l8w8jwt_claim* claims = NULL;
+    size_t claims_length = 0;
+    int decode_result = l8w8jwt_decode(&params, &validation_result, &claims, &claims_length);
+
+    if (decode_result == L8W8JWT_SUCCESS && validation_result == L8W8JWT_VALID) {
+        struct l8w8jwt_claim* sub_claim = l8w8jwt_get_claim(claims, claims_length, "sub", 3);
+        if (sub_claim && sub_claim->type == L8W8JWT_CLAIM_TYPE_STRING) {
+            // CORRECTED ACCESS: The 'value' field is a direct char*, not a union.
+            claims_out->sub = strdup(sub_claim->value);
+            log_system(LOG_DEBUG, "Auth: JWT validation successful for user '%s'.", sub_claim->value);
+
+            struct l8w8jwt_claim* exp_claim = l8w8jwt_get_claim(claims, claims_length, "exp", 3);
+            if (exp_claim && exp_claim->type == L8W8JWT_CLAIM_TYPE_INTEGER) {
+                claims_out->exp = (time_t)strtoll(exp_claim->value, NULL, 10);
+            }
+            struct l8w8jwt_claim* iat_claim = l8w8jwt_get_claim(claims, claims_length, "iat", 3);
+            if (iat_claim && iat_claim->type == L8W8JWT_CLAIM_TYPE_INTEGER) {
+                claims_out->iat = (time_t)strtoll(iat_claim->value, NULL, 10);
+            }
+            struct l8w8jwt_claim* jti_claim = l8w8jwt_get_claim(claims, claims_length, "jti", 3);
+            if (jti_claim && jti_claim->type == L8W8JWT_CLAIM_TYPE_STRING) {
+                claims_out->jti = strdup(jti_claim->value);
+            }
+            struct l8w8jwt_claim* roles_claim = l8w8jwt_get_claim(claims, claims_length, "roles", 5);
+            if (roles_claim && roles_claim->type == L8W8JWT_CLAIM_TYPE_STRING) {
+                claims_out->roles = strdup(roles_claim->value);
+            } else if (roles_claim && roles_claim->type == L8W8JWT_CLAIM_TYPE_ARRAY) {
+                // Arrays come back as their JSON text
+                yyjson_doc* doc = yyjson_read(roles_claim->value, roles_claim->value_length, 0);
+                claims_out->roles = roles_from_json(yyjson_doc_get_root(doc));
+                yyjson_doc_free(doc);
+            }
+            result = claims_out->sub ? 0 : -1;
+        } else {
+             log_system_rl(LOG_WARNING, "JWT is valid, but 'sub' claim is missing or not a string.");
+        }
+    } else {
+        log_system_rl(LOG_INFO, "JWT validation failed. Decode status: %d, Validation result: %d", decode_result, validation_result);
+    }
+
+    l8w8jwt_free_claims(claims, claims_length);
+    if (result != 0) {
+        jwt_claims_free(claims_out);
+    }
+    return result;
+}
+
+// Full signature and claim check (native, then l8w8jwt). Thread-safe.
+// Returns 0 and fills *claims_out on success.
+static int jwt_verify_uncached(const char* token, size_t token_len, const ServerConfig* config,
+                               time_t now, JwtClaims* claims_out) {
+    char kid[JWT_KID_MAX];
+    JwtNativeResult native = jwt_verify_native(token, token_len, now, claims_out, kid);
+    if (native == JWT_NATIVE_UNSUPPORTED) {
+        if (jwt_verify_l8w8jwt(token, token_len, kid, config, claims_out) != 0) {
+            return -1;
+        }
+    } else if (native == JWT_NATIVE_INVALID) {
+        log_system_rl(LOG_INFO, "JWT validation failed (native verifier).");
+        return -1;
+    }
+
+    // A revocation by user only lasts JwtMaxTokenLifetime, so no token may live longer
+    if (claims_out->iat == 0 || claims_out->exp == 0 ||
+        claims_out->exp - claims_out->iat > config->jwt_max_token_lifetime) {
+        log_system_rl(LOG_INFO, "JWT rejected: lifetime missing or above JwtMaxTokenLifetime (%lld s).",
+                      (long long)config->jwt_max_token_lifetime);
+        jwt_claims_free(claims_out);
+        return -1;
+    }
+    return 0;
+}
+
+// Moves freshly verified claims into the cache. Returns the claims, owned by
+// the cache or still by *scratch.
+static const JwtClaims* jwt_cache_adopt(const char* token, size_t token_len, uint64_t token_hash,
+                                        time_t now, JwtClaims* scratch) {
+    // Only tokens with an expiry are cached, the entry dies with the token
+    if (scratch->exp > now) {
+        jwt_cache_insert(token, token_len, token_hash, scratch);
+        const JwtClaims* cached = jwt_cache_lookup(token, token_len, token_hash, now);
+        if (cached) return cached;
+    }
+    return scratch->sub ? scratch : NULL;
+}
+
+// Verifies a token (cache, then full check) without the revocation check.
+// On success returns the claims, owned by the cache or by *scratch; the
+// pointer is valid until the next call. Reactor thread only.
+static const JwtClaims* jwt_verify(const char* token, size_t token_len, uint64_t token_hash,
+                                   ServerConfig* config, JwtClaims* scratch) {
+    time_t now = time(NULL);
+    memset(scratch, 0, sizeof(*scratch));
+
+    const JwtClaims* cached = jwt_cache_lookup(token, token_len, token_hash, now);
+    if (cached) {
+        log_system(LOG_DEBUG, "Auth: JWT cache hit for user '%s'.", cached->sub);
+        return cached;
+    }
+
+    if (jwt_verify_uncached(token, token_len, config, now, scratch) != 0) {
+        return NULL;
+    }
+    return jwt_cache_adopt(token, token_len, token_hash, now, scratch);
+}
+
+// Revocation is checked on every request, cache hits included. On success
+// the token's roles are attached to the request.
+// Returns the username (caller frees), or NULL if the token was revoked.
+static char* accept_claims(Connection* conn, const JwtClaims* claims, uint64_t token_hash) {
+    if (revocation_is_revoked(claims->jti, claims->sub, claims->iat)) {
+        log_system_rl(LOG_INFO, "Auth: Rejected revoked token for user '%s'.", claims->sub);
+        JwtCacheEntry* entry = &jwt_cache[token_hash & (JWT_CACHE_SLOTS - 1)];
+        if (claims == &entry->claims) {
+            jwt_cache_evict(entry);
+        }
+        return NULL;
+    }
+    conn->request.auth_roles = arena_strdup(&conn->request.arena, claims->roles);
+    return strdup(claims->sub);
+}
+
+// ============================================================================
+// Per-connection context
+// ============================================================================
+// Keep-alive clients send the same Authorization header with every request.
+// The connection remembers the token it last accepted, so those requests skip
+// even the global cache. Only the revocation check is repeated.
+
+void auth_context_clear(Connection* conn) {
+    AuthContext* ctx = &conn->auth;
+    free(ctx->token);
+    free(ctx->sub);
+    free(ctx->jti);
+    free(ctx->roles);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+static void conn_auth_remember(Connection* conn, const char* token, size_t token_len, uint64_t token_hash,
+                               const JwtClaims* claims) {
+    auth_context_clear(conn);
+    if (claims->exp == 0 || token_len > JWT_CACHE_MAX_TOKEN_LEN) {
+        return; // Without an expiry we could never drop it
+    }
+    AuthContext* ctx = &conn->auth;
+    ctx->token = strndup(token, token_len);
+    ctx->sub = strdup(claims->sub);
+    ctx->jti = claims->jti ? strdup(claims->jti) : NULL;
+    ctx->roles = claims->roles ? strdup(claims->roles) : NULL;
+    if (!ctx->token || !ctx->sub || (claims->jti && !ctx->jti) || (claims->roles && !ctx->roles)) {
+        auth_context_clear(conn);
+        return;
+    }
+    ctx->token_len = token_len;
+    ctx->token_hash = token_hash;
+    ctx->exp = claims->exp;
+    ctx->iat = claims->iat;
+}
+
+// Returns the remembered claims (borrowed from conn->auth) if they belong to this token.
+static bool conn_auth_lookup(Connection* conn, const char* token, size_t token_len, uint64_t token_hash,
+                             time_t now, JwtClaims* view) {
+    AuthContext* ctx = &conn->auth;
+    if (!ctx->token || ctx->token_hash != token_hash || ctx->token_len != token_len ||
+        !constant_time_equals(ctx->token, token, token_len)) {
+        return false;
+    }
+    if (now >= ctx->exp) {
+        auth_context_clear(conn);
+        return false;
+    }
+    view->sub = ctx->sub;
+    view->jti = ctx->jti;
+    view->roles = ctx->roles;
+    view->exp = ctx->exp;
+    view->iat = ctx->iat;
+    return true;
+}
+
+// Extracts the token from "Authorization: Bearer <token>", or NULL.
+static const char* find_bearer_token(Connection* conn) {
     const char* auth_header = NULL;
     for (int i = 0; i < conn->request.header_count; i++) {
         if (strcasecmp(conn->request.headers[i].key, "Authorization") == 0) {
@@ -19,45 +622,47 @@ char* authenticate_request(Connection* conn, ServerConfig* config) {
     }
 
     if (!auth_header || strncasecmp(auth_header, "Bearer ", 7) != 0) {
+        return NULL;
+    }
+    return auth_header + 7;
+}
+
+char* authenticate_request(Connection* conn, ServerConfig* config) {
+    // 1. Find the Authorization header
+    const char* token = find_bearer_token(conn);
+    if (!token) {
         log_system(LOG_DEBUG, "Auth failed: Missing or malformed Authorization header.");
         return NULL;
     }
 
-    const char* token = auth_header + 7;
     char* username = NULL;
 
     log_system(LOG_DEBUG, "Auth: Attempting to validate token.");
 
     if (config->jwt_enabled) {
         // --- Validate real JWT ---
-        struct l8w8jwt_decoding_params params;
-        l8w8jwt_decoding_params_init(&params);
-        params.alg = L8W8JWT_ALG_HS256;
-        params.jwt = (char*)token;
-        params.jwt_length = strlen(token);
-        params.verification_key = (unsigned char*)config->jwt_secret;
-        params.verification_key_length = strlen(config->jwt_secret);
-        params.validate_exp = 1;
-
-        enum l8w8jwt_validation_result validation_result;
-        struct l8w8jwt_claim* claims = NULL;
-        size_t claims_length = 0;
-        int decode_result = l8w8jwt_decode(&params, &validation_result, &claims, &claims_length);
-
-        if (decode_result == L8W8JWT_SUCCESS && validation_result == L8W8JWT_VALID) {
-            struct l8w8jwt_claim* sub_claim = l8w8jwt_get_claim(claims, claims_length, "sub", 3);
-            if (sub_claim && sub_claim->type == L8W8JWT_CLAIM_TYPE_STRING) {
-                // CORRECTED ACCESS: The 'value' field is a direct char*, not a union.
-                username = strdup(sub_claim->value);
-                log_system(LOG_DEBUG, "Auth: JWT validation successful for user '%s'.", username);
-            } else {
-                 log_system(LOG_WARNING, "JWT is valid, but 'sub' claim is missing or not a string.");
+        size_t token_len = strlen(token);
+        uint64_t token_hash = hash_token(token, token_len);
+
+        JwtClaims remembered;
+        if (conn_auth_lookup(conn, token, token_len, token_hash, time(NULL), &remembered)) {
+            log_system(LOG_DEBUG, "Auth: Reusing connection auth context for user '%s'.", remembered.sub);
+            username = accept_claims(conn, &remembered, token_hash);
+            if (!username) {
+                auth_context_clear(conn);
             }
-        } else {
-            log_system(LOG_INFO, "JWT validation failed. Decode status: %d, Validation result: %d", decode_result, validation_result);
+            return username;
         }
-        
-        l8w8jwt_free_claims(claims, claims_length);
+
+        JwtClaims scratch;
+        const JwtClaims* claims = jwt_verify(token, token_len, token_hash, config, &scratch);
+        if (claims) {
+            username = accept_claims(conn, claims, token_hash);
+            if (username) {
+                conn_auth_remember(conn, token, token_len, token_hash, claims);
+            }
+        }
+        jwt_claims_free(&scratch);
 
     } else {
         // --- "Validate" mock token ---
@@ -73,22 +678,155 @@ char* authenticate_request(Connection* conn, ServerConfig* config) {
     return username;
 }
 
+// ============================================================================
+// Asynchronous verification
+// ============================================================================
+// An RSA or ECDSA check costs tens to hundreds of microseconds, long enough to
+// stall every other connection on the reactor. Cache misses for asymmetric
+// algorithms are therefore verified on the worker pool; the cache, revocation
+// set and the connection are only touched again in the completion, which runs
+// on the reactor thread.
+
+typedef struct {
+    Connection* conn;
+    ServerConfig* config;
+    int epollFd;
+    AuthCallback callback;
+    char* token;         // Copy, the request may be gone when the job runs
+    size_t token_len;
+    uint64_t token_hash;
+    int result;          // jwt_verify_uncached() result
+    JwtClaims claims;
+} AuthJob;
+
+static void auth_job_run(void* arg) {
+    AuthJob* job = arg;
+    job->result = jwt_verify_uncached(job->token, job->token_len, job->config, time(NULL), &job->claims);
+}
+
+static void auth_job_done(void* arg) {
+    AuthJob* job = arg;
+    if (server_async_end(job->conn) == 0) {
+        char* username = NULL;
+        if (job->result == 0) {
+            const JwtClaims* claims = jwt_cache_adopt(job->token, job->token_len, job->token_hash,
+                                                      time(NULL), &job->claims);
+            if (claims) username = accept_claims(job->conn, claims, job->token_hash);
+            if (username) {
+                conn_auth_remember(job->conn, job->token, job->token_len, job->token_hash, claims);
+            }
+        }
+        job->callback(job->conn, job->config, job->epollFd, username);
+    }
+    // else: the client went away while we were verifying
+    jwt_claims_free(&job->claims);
+    free(job->token);
+    free(job);
+}
+
+void authenticate_request_async(Connection* conn, ServerConfig* config, int epollFd, AuthCallback callback) {
+    const char* token = find_bearer_token(conn);
+    // Anything that needs no public-key operation is answered inline
+    if (!token || !config->jwt_enabled || !jwt_alg_is_asymmetric(auth_alg) || !worker_pool_enabled()) {
+        callback(conn, config, epollFd, authenticate_request(conn, config));
+        return;
+    }
+    size_t token_len = strlen(token);
+    uint64_t token_hash = hash_token(token, token_len);
+    JwtClaims remembered;
+    if (conn_auth_lookup(conn, token, token_len, token_hash, time(NULL), &remembered) ||
+        jwt_cache_lookup(token, token_len, token_hash, time(NULL))) {
+        callback(conn, config, epollFd, authenticate_request(conn, config));
+        return;
+    }
+
+    AuthJob* job = calloc(1, sizeof(AuthJob));
+    if (job) job->token = strndup(token, token_len);
+    if (!job || !job->token) {
+        free(job);
+        callback(conn, config, epollFd, NULL);
+        return;
+    }
+    job->conn = conn;
+    job->config = config;
+    job->epollFd = epollFd;
+    job->callback = callback;
+    job->token_len = token_len;
+    job->token_hash = token_hash;
+
+    server_async_begin(conn);
+    if (worker_pool_submit(auth_job_run, auth_job_done, job) != 0) {
+        server_async_end(conn);
+        free(job->token);
+        free(job);
+        callback(conn, config, epollFd, authenticate_request(conn, config));
+    }
+}
+
+// Is `name` (len bytes) one of the entries of a comma/space-separated list?
+static bool role_list_contains(const char* list, const char* name, size_t len) {
+    while (*list) {
+        list += strspn(list, ", ");
+        size_t n = strcspn(list, ", ");
+        if (n == len && memcmp(list, name, len) == 0) return true;
+        list += n;
+    }
+    return false;
+}
+
+bool auth_has_role(const HttpRequest* req, const char* roles) {
+    if (!roles || !*roles) return true;
+    if (!req->auth_roles) return false;
+    while (*roles) {
+        roles += strspn(roles, ", ");
+        size_t n = strcspn(roles, ", ");
+        if (n && role_list_contains(req->auth_roles, roles, n)) return true;
+        roles += n;
+    }
+    return false;
+}
+
+bool auth_needs_worker_pool(const ServerConfig* config) {
+    return config->jwt_enabled && config->jwt_verify_threads > 0 &&
+           jwt_alg_is_asymmetric(jwt_alg_from_name(config->jwt_algorithm));
+}
+
 char* generate_token_for_user(const char* username, ServerConfig* config) {
     if (!username) return NULL;
     log_system(LOG_DEBUG, "Auth: Generating token for user '%s'. JWT enabled: %d", username, config->jwt_enabled);
 
     if (config->jwt_enabled) {
+        if (jwt_alg_is_asymmetric(auth_alg) || auth_alg == JWT_ALG_UNKNOWN) {
+            // We only hold public keys; tokens come from the identity provider
+            log_system(LOG_ERROR, "Auth: Cannot issue tokens with JwtAlgorithm '%s'.", config->jwt_algorithm);
+            return NULL;
+        }
+
         // --- Generate a real JWT ---
         char* jwt = NULL;
         size_t jwt_length;
         struct l8w8jwt_encoding_params params;
         l8w8jwt_encoding_params_init(&params);
 
-        params.alg = L8W8JWT_ALG_HS256;
+        // A random token ID makes single-token revocation (logout) possible
+        char jti[33];
+        unsigned char jti_bytes[16];
+        bool has_jti = getrandom(jti_bytes, sizeof(jti_bytes), 0) == (ssize_t)sizeof(jti_bytes);
+        if (has_jti) {
+            for (size_t i = 0; i < sizeof(jti_bytes); i++) {
+                snprintf(jti + i * 2, 3, "%02x", jti_bytes[i]);
+            }
+        } else {
+            log_system(LOG_WARNING, "Auth: getrandom failed, issuing token without 'jti'.");
+        }
+
+        params.alg = jwt_alg_to_l8w8jwt(auth_alg);
         params.sub = (char*)username;
         params.iss = "my-web-server";
+        params.jti = has_jti ? jti : NULL;
+        params.jti_length = has_jti ? strlen(jti) : 0;
         params.iat = time(NULL);
-        params.exp = time(NULL) + (15 * 60);
+        params.exp = time(NULL) + JWT_LIFETIME_SECONDS;
         params.secret_key = (unsigned char*)config->jwt_secret;
         params.secret_key_length = strlen(config->jwt_secret);
         params.out = &jwt;
@@ -110,4 +848,53 @@ char* generate_token_for_user(const char* username, ServerConfig* config) {
         log_system(LOG_DEBUG, "Auth: Created mock token for user '%s'.", username);
         return strdup(username);
     }
-} 
\ No newline at end of file
+}
+
+int auth_revoke_token(const char* token, ServerConfig* config) {
+    if (!token || !config->jwt_enabled) {
+        return -1;
+    }
+
+    size_t token_len = strlen(token);
+    uint64_t token_hash = hash_token(token, token_len);
+    JwtClaims scratch;
+    const JwtClaims* claims = jwt_verify(token, token_len, token_hash, config, &scratch);
+    if (!claims) {
+        jwt_claims_free(&scratch);
+        return -1; // Invalid or expired tokens need no revocation
+    }
+
+    int result;
+    if (claims->jti) {
+        result = revocation_add_token_id(claims->jti, claims->exp);
+    } else {
+        // Without a token ID, revoke every token of the user up to this one. Those
+        // were issued no later and live at most max_token_lifetime; this one until exp.
+        time_t expires = claims->iat + 1 + max_token_lifetime;
+        if (claims->exp > expires) {
+            expires = claims->exp;
+        }
+        result = revocation_add_user(claims->sub, claims->iat + 1, expires);
+    }
+
+    JwtCacheEntry* entry = &jwt_cache[token_hash & (JWT_CACHE_SLOTS - 1)];
+    if (claims == &entry->claims) {
+        jwt_cache_evict(entry);
+    }
+    jwt_claims_free(&scratch);
+    return result;
+}
+
+int auth_revoke_request_token(Connection* conn, ServerConfig* config) {
+    auth_context_clear(conn);
+    return auth_revoke_token(find_bearer_token(conn), config);
+}
+
+int auth_revoke_user(const char* username) {
+    if (!username) {
+        return -1;
+    }
+    // Every token issued up to and including this second
+    time_t issued_before = time(NULL) + 1;
+    return revocation_add_user(username, issued_before, issued_before + max_token_lifetime);
+}
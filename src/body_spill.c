@@ -0,0 +1,97 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // For O_TMPFILE
+#endif
+#include "body_spill.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+static size_t memory_threshold = 1024 * 1024;
+static size_t memory_budget = 64 * 1024 * 1024;
+static size_t memory_in_use = 0; // Only touched on the reactor thread
+static char spill_dir[256] = "/tmp";
+
+void body_spill_init(const ServerConfig* config) {
+    memory_threshold = config->body_memory_threshold;
+    memory_budget = config->body_memory_budget;
+    snprintf(spill_dir, sizeof(spill_dir), "%s", config->body_spill_dir);
+    log_system(LOG_INFO, "BodySpill: threshold=%zu budget=%zu dir=%s",
+               memory_threshold, memory_budget, spill_dir);
+}
+
+bool body_memory_reserve(size_t current, size_t wanted) {
+    if (wanted <= current) {
+        return true;
+    }
+    if (memory_threshold && wanted > memory_threshold) {
+        return false;
+    }
+    size_t extra = wanted - current;
+    if (memory_budget && memory_in_use + extra > memory_budget) {
+        log_system_rl(LOG_INFO, "BodySpill: Memory budget of %zu bytes in use, spilling to disk.", memory_budget);
+        return false;
+    }
+    memory_in_use += extra;
+    return true;
+}
+
+void body_memory_release(size_t bytes) {
+    memory_in_use = bytes > memory_in_use ? 0 : memory_in_use - bytes;
+}
+
+int body_spill_open() {
+    int fd = open(spill_dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd == -1 && (errno == EOPNOTSUPP || errno == EISDIR || errno == EINVAL)) {
+        // No O_TMPFILE on this filesystem: an unlinked mkstemp file is equivalent
+        char path[300];
+        snprintf(path, sizeof(path), "%s/body-XXXXXX", spill_dir);
+        fd = mkostemp(path, O_CLOEXEC);
+        if (fd != -1) {
+            unlink(path);
+        }
+    }
+    if (fd == -1) {
+        log_system_rl(LOG_ERROR, "BodySpill: Cannot create a temporary file in '%s': %s", spill_dir, strerror(errno));
+    }
+    return fd;
+}
+
+int body_spill_write(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_system_rl(LOG_ERROR, "BodySpill: write: %s", strerror(errno));
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+char* body_spill_map(int fd, size_t len) {
+    // Extra zero bytes in the file give the mapping its NUL terminator and padding
+    static const char padding[BODY_SPILL_PADDING];
+    if (body_spill_write(fd, padding, sizeof(padding)) != 0) {
+        return NULL;
+    }
+    char* body = mmap(NULL, len + BODY_SPILL_PADDING, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (body == MAP_FAILED) {
+        log_system_rl(LOG_ERROR, "BodySpill: mmap: %s", strerror(errno));
+        return NULL;
+    }
+    madvise(body, len + BODY_SPILL_PADDING, MADV_SEQUENTIAL);
+    return body;
+}
+
+void body_spill_unmap(char* body, size_t len) {
+    if (body) {
+        munmap(body, len + BODY_SPILL_PADDING);
+    }
+}
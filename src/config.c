@@ -2,6 +2,7 @@
 #define _GNU_SOURCE
 #endif
 #include "config.h"
+#include "auth.h" // For auth_init
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -25,13 +26,31 @@ void loadConfig(const char* filepath, ServerConfig* config) {
     strcpy(config->log_path, "log");
     config->log_level = LOG_INFO;
     config->log_target = LOG_TARGET_FILE;
+    config->log_rate_limit = 10;
+    config->access_log_sample_rate = 1;
+    config->log_rotate_size_mb = 0;
+    config->log_rotate_daily = 0;
     // New defaults
     config->jwt_enabled = 1;
     strcpy(config->jwt_secret, "a-very-secret-and-long-key-that-is-at-least-32-bytes");
+    strcpy(config->jwt_algorithm, "HS256");
+    config->jwt_public_key[0] = '\0';
+    config->jwt_jwks_file[0] = '\0';
+    config->jwt_verify_threads = 2;
+    config->jwt_max_token_lifetime = 24 * 60 * 60;
+    config->revocation_snapshot[0] = '\0';
     config->mime_enabled = 1;
+    config->mime_types_file[0] = '\0';
+    config->static_mmap_threshold = 64 * 1024;
+    config->static_mmap_cache_size = 256 * 1024 * 1024;
+    config->max_body_size = 10 * 1024 * 1024;
+    config->body_memory_threshold = 1024 * 1024;
+    config->body_memory_budget = 64 * 1024 * 1024;
+    strcpy(config->body_spill_dir, "/tmp");
 
     if (!filepath) {
         log_system(LOG_INFO, "Config: No config file provided, using default settings.");
+        auth_init(config);
         return; // Use defaults if no file path is provided
     }
 
@@ -40,6 +59,7 @@ void loadConfig(const char* filepath, ServerConfig* config) {
         // This is not a fatal error, just means we use defaults.
         // We might want to log this at a WARNING level once the logger is initialized.
         log_system(LOG_WARNING, "Config: Could not open config file '%s'. Using default settings.", filepath);
+        auth_init(config);
         return;
     }
 
@@ -77,17 +97,74 @@ void loadConfig(const char* filepath, ServerConfig* config) {
             if (strcmp(trimmed_value, "stdout") == 0) config->log_target = LOG_TARGET_STDOUT;
             else if (strcmp(trimmed_value, "file") == 0) config->log_target = LOG_TARGET_FILE;
             log_system(LOG_DEBUG, "Config: Set %s = %s", key, trimmed_value);
+        } else if (strcmp(key, "LogRateLimit") == 0) {
+            config->log_rate_limit = atoi(trimmed_value);
+            log_system(LOG_DEBUG, "Config: Set %s = %d", key, config->log_rate_limit);
+        } else if (strcmp(key, "AccessLogSampleRate") == 0) {
+            config->access_log_sample_rate = atoi(trimmed_value);
+            log_system(LOG_DEBUG, "Config: Set %s = %d", key, config->access_log_sample_rate);
+        } else if (strcmp(key, "LogRotateSizeMB") == 0) {
+            config->log_rotate_size_mb = atoi(trimmed_value);
+            log_system(LOG_DEBUG, "Config: Set %s = %d", key, config->log_rotate_size_mb);
+        } else if (strcmp(key, "LogRotateDaily") == 0) {
+            config->log_rotate_daily = atoi(trimmed_value);
+            log_system(LOG_DEBUG, "Config: Set %s = %d", key, config->log_rotate_daily);
         } else if (strcmp(key, "JwtEnabled") == 0) {
             config->jwt_enabled = atoi(trimmed_value);
             log_system(LOG_DEBUG, "Config: Set %s = %d", key, config->jwt_enabled);
         } else if (strcmp(key, "JwtSecret") == 0) {
             strcpy(config->jwt_secret, trimmed_value);
             log_system(LOG_DEBUG, "Config: Set %s = [SECRET]", key);
+        } else if (strcmp(key, "JwtAlgorithm") == 0) {
+            snprintf(config->jwt_algorithm, sizeof(config->jwt_algorithm), "%s", trimmed_value);
+            log_system(LOG_DEBUG, "Config: Set %s = %s", key, config->jwt_algorithm);
+        } else if (strcmp(key, "JwtPublicKey") == 0) {
+            strcpy(config->jwt_public_key, trimmed_value);
+            log_system(LOG_DEBUG, "Config: Set %s = %s", key, config->jwt_public_key);
+        } else if (strcmp(key, "JwtJwksFile") == 0) {
+            strcpy(config->jwt_jwks_file, trimmed_value);
+            log_system(LOG_DEBUG, "Config: Set %s = %s", key, config->jwt_jwks_file);
+        } else if (strcmp(key, "JwtVerifyThreads") == 0) {
+            config->jwt_verify_threads = atoi(trimmed_value);
+            log_system(LOG_DEBUG, "Config: Set %s = %d", key, config->jwt_verify_threads);
+        } else if (strcmp(key, "JwtMaxTokenLifetime") == 0) {
+            long lifetime = atol(trimmed_value);
+            if (lifetime > 0) {
+                config->jwt_max_token_lifetime = lifetime;
+            }
+            log_system(LOG_DEBUG, "Config: Set %s = %ld", key, config->jwt_max_token_lifetime);
+        } else if (strcmp(key, "RevocationSnapshot") == 0) {
+            strcpy(config->revocation_snapshot, trimmed_value);
+            log_system(LOG_DEBUG, "Config: Set %s = %s", key, config->revocation_snapshot);
         } else if (strcmp(key, "MimeEnabled") == 0) {
             config->mime_enabled = atoi(trimmed_value);
             log_system(LOG_DEBUG, "Config: Set %s = %d", key, config->mime_enabled);
+        } else if (strcmp(key, "MimeTypesFile") == 0) {
+            strcpy(config->mime_types_file, trimmed_value);
+            log_system(LOG_DEBUG, "Config: Set %s = %s", key, config->mime_types_file);
+        } else if (strcmp(key, "StaticMmapThreshold") == 0) {
+            config->static_mmap_threshold = (size_t)strtoull(trimmed_value, NULL, 10);
+            log_system(LOG_DEBUG, "Config: Set %s = %zu", key, config->static_mmap_threshold);
+        } else if (strcmp(key, "StaticMmapCacheSize") == 0) {
+            config->static_mmap_cache_size = (size_t)strtoull(trimmed_value, NULL, 10);
+            log_system(LOG_DEBUG, "Config: Set %s = %zu", key, config->static_mmap_cache_size);
+        } else if (strcmp(key, "MaxBodySize") == 0) {
+            config->max_body_size = (size_t)strtoull(trimmed_value, NULL, 10);
+            log_system(LOG_DEBUG, "Config: Set %s = %zu", key, config->max_body_size);
+        } else if (strcmp(key, "BodyMemoryThreshold") == 0) {
+            config->body_memory_threshold = (size_t)strtoull(trimmed_value, NULL, 10);
+            log_system(LOG_DEBUG, "Config: Set %s = %zu", key, config->body_memory_threshold);
+        } else if (strcmp(key, "BodyMemoryBudget") == 0) {
+            config->body_memory_budget = (size_t)strtoull(trimmed_value, NULL, 10);
+            log_system(LOG_DEBUG, "Config: Set %s = %zu", key, config->body_memory_budget);
+        } else if (strcmp(key, "BodySpillDir") == 0) {
+            strcpy(config->body_spill_dir, trimmed_value);
+            log_system(LOG_DEBUG, "Config: Set %s = %s", key, config->body_spill_dir);
         }
     }
 
     fclose(fp);
-} 
\ No newline at end of file
+
+    // Derived state (e.g. precomputed JWT key pads) must follow the final settings
+    auth_init(config);
+}
@@ -0,0 +1,205 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "file_cache.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+
+#define FILE_CACHE_BUCKETS 256
+#define WATCH_EVENTS (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF)
+
+struct FileMapping {
+    char* data;
+    size_t size;
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    int refs;
+    int wd;                              // inotify watch, -1 = none
+    bool cached;                         // In the table and the LRU list
+    FileMapping* hash_next;
+    FileMapping* lru_prev;               // Towards the most recently used
+    FileMapping* lru_next;
+};
+
+static struct {
+    FileMapping* buckets[FILE_CACHE_BUCKETS];
+    FileMapping* lru_head;               // Most recently used
+    FileMapping* lru_tail;
+    size_t cached_bytes;
+    size_t threshold;                    // Smallest file served mapped, 0 = never
+    size_t capacity;                     // Bytes of mappings kept for reuse
+    int inotify_fd;
+} C = { .threshold = 64 * 1024, .capacity = 256 * 1024 * 1024, .inotify_fd = -1 };
+
+static size_t bucket_of(dev_t dev, ino_t ino) {
+    uint64_t h = ((uint64_t)ino ^ ((uint64_t)dev << 32)) * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h >> 56) % FILE_CACHE_BUCKETS;
+}
+
+void file_cache_init(const ServerConfig* config) {
+    C.threshold = config->static_mmap_threshold;
+    C.capacity = config->static_mmap_cache_size;
+    if (C.threshold && C.inotify_fd == -1) {
+        C.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (C.inotify_fd == -1) {
+            log_system(LOG_WARNING, "FileCache: inotify unavailable (%s), changed files are noticed on the next request only.",
+                       strerror(errno));
+        }
+    }
+    log_system(LOG_INFO, "FileCache: mmap threshold=%zu cache=%zu", C.threshold, C.capacity);
+}
+
+bool file_cache_wants(size_t size) {
+    return C.threshold && size >= C.threshold;
+}
+
+int file_cache_event_fd(void) {
+    return C.inotify_fd;
+}
+
+const char* file_cache_data(const FileMapping* map) {
+    return map->data;
+}
+
+size_t file_cache_size(const FileMapping* map) {
+    return map->size;
+}
+
+static void destroy(FileMapping* map) {
+    log_system(LOG_DEBUG, "FileCache: Unmapping inode %lu (%zu bytes).", (unsigned long)map->ino, map->size);
+    munmap(map->data, map->size);
+    free(map);
+}
+
+static void lru_unlink(FileMapping* map) {
+    if (map->lru_prev) map->lru_prev->lru_next = map->lru_next;
+    else C.lru_head = map->lru_next;
+    if (map->lru_next) map->lru_next->lru_prev = map->lru_prev;
+    else C.lru_tail = map->lru_prev;
+    map->lru_prev = map->lru_next = NULL;
+}
+
+static void lru_push_front(FileMapping* map) {
+    map->lru_prev = NULL;
+    map->lru_next = C.lru_head;
+    if (C.lru_head) C.lru_head->lru_prev = map;
+    else C.lru_tail = map;
+    C.lru_head = map;
+}
+
+// Takes a mapping out of the cache; it lives on while connections still send from it
+static void detach(FileMapping* map) {
+    FileMapping** link = &C.buckets[bucket_of(map->dev, map->ino)];
+    while (*link != map) link = &(*link)->hash_next;
+    *link = map->hash_next;
+    lru_unlink(map);
+    C.cached_bytes -= map->size;
+    map->cached = false;
+    if (map->wd != -1) {
+        inotify_rm_watch(C.inotify_fd, map->wd);
+        map->wd = -1;
+    }
+    if (map->refs == 0) {
+        destroy(map);
+    }
+}
+
+// Unmaps idle mappings, least recently used first, until the cache fits
+static void evict(void) {
+    FileMapping* map = C.lru_tail;
+    while (map && C.cached_bytes > C.capacity) {
+        FileMapping* prev = map->lru_prev;
+        if (map->refs == 0) {
+            detach(map);
+        }
+        map = prev;
+    }
+}
+
+FileMapping* file_cache_acquire(int fd, const struct stat* st) {
+    if (st->st_size <= 0) return NULL;
+
+    size_t bucket = bucket_of(st->st_dev, st->st_ino);
+    for (FileMapping* map = C.buckets[bucket]; map; map = map->hash_next) {
+        if (map->dev != st->st_dev || map->ino != st->st_ino) continue;
+        if (map->size == (size_t)st->st_size && map->mtime.tv_sec == st->st_mtim.tv_sec &&
+            map->mtime.tv_nsec == st->st_mtim.tv_nsec) {
+            map->refs++;
+            lru_unlink(map);
+            lru_push_front(map);
+            return map;
+        }
+        detach(map); // Changed since it was mapped
+        break;
+    }
+
+    FileMapping* map = calloc(1, sizeof(FileMapping));
+    if (!map) return NULL;
+    map->data = mmap(NULL, (size_t)st->st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map->data == MAP_FAILED) {
+        log_system_rl(LOG_WARNING, "FileCache: mmap of %zu bytes failed: %s", (size_t)st->st_size, strerror(errno));
+        free(map);
+        return NULL;
+    }
+    map->size = (size_t)st->st_size;
+    map->dev = st->st_dev;
+    map->ino = st->st_ino;
+    map->mtime = st->st_mtim;
+    map->refs = 1;
+    map->wd = -1;
+    log_system(LOG_DEBUG, "FileCache: Mapped inode %lu (%zu bytes).", (unsigned long)map->ino, map->size);
+
+    if (map->size > C.capacity) {
+        return map; // Never kept: unmapped when the last sender is done
+    }
+    if (C.inotify_fd != -1) {
+        // inotify wants a path; the fd's /proc link names exactly this file
+        char proc_path[64];
+        snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", fd);
+        map->wd = inotify_add_watch(C.inotify_fd, proc_path, WATCH_EVENTS);
+    }
+    map->hash_next = C.buckets[bucket];
+    C.buckets[bucket] = map;
+    lru_push_front(map);
+    map->cached = true;
+    C.cached_bytes += map->size;
+    evict();
+    return map;
+}
+
+void file_cache_release(FileMapping* map) {
+    if (!map || --map->refs > 0) return;
+    if (!map->cached) {
+        destroy(map);
+    } else if (C.cached_bytes > C.capacity) {
+        evict(); // Mappings in use could not be evicted earlier
+    }
+}
+
+void file_cache_handle_events(void) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(C.inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + n; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len) {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            for (FileMapping* map = C.lru_head; map; map = map->lru_next) {
+                if (map->wd != ev->wd) continue;
+                log_system(LOG_DEBUG, "FileCache: Inode %lu changed (mask 0x%x), dropping its mapping.",
+                           (unsigned long)map->ino, ev->mask);
+                if (ev->mask & IN_IGNORED) {
+                    map->wd = -1; // The kernel removed the watch already
+                }
+                detach(map);
+                break;
+            }
+        }
+    }
+}
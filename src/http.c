@@ -9,6 +9,9 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/openat2.h>
 #include <errno.h> // Required for errno
 #include "logger.h"
 #include "config.h"
@@ -16,8 +19,11 @@
 #include <strings.h>
 #include "utils.h"
 #include "server.h" // For queue_data_for_writing
+#include "body_spill.h"
+#include "mime.h"
+#include "response.h"
+#include "file_cache.h"
 
-#define MAX_PATH_LEN 256
 
 // Helper function to trim leading/trailing whitespace - NO LONGER USED
 /*
@@ -45,77 +51,284 @@ int parseHttpRequest(char* requestStr, size_t requestLen, HttpRequest* req) {
 
 void freeHttpRequest(HttpRequest* req) {
     if (req) {
-        free(req->method);
-        free(req->raw_uri);
-        free(req->uri);
-        free(req->raw_query_string);
-        free(req->query_string);
-        free(req->authed_user);
-        for (int i = 0; i < req->header_count; i++) {
-            free(req->headers[i].key);
-            free(req->headers[i].value);
+        // URI, headers, auth strings, parameters and the JSON document live in the arena
+        // Spilled body: mapping and temp file (an in-memory body lives in read_buf)
+        if (req->body_spilled) {
+            body_spill_unmap(req->body, req->content_length);
+            close(req->body_fd);
         }
-        // Free pre-parsed query parameters (Phase 2)
-        for (int i = 0; i < req->query_param_count; i++) {
-            free(req->query_params[i].key);
-            free(req->query_params[i].value);
+        body_memory_release(req->body_mem_reserved);
+        // Use memset to be safe, especially since this struct is part of another struct.
+        // The arena's chunks stay with the connection for its next request.
+        Arena arena = req->arena;
+        memset(req, 0, sizeof(HttpRequest));
+        arena_reset(&arena);
+        req->arena = arena;
+    }
+}
+
+#define CHUNK_LINE_MAX 1024    // Chunk-size line including extensions
+#define TRAILER_LINE_MAX 8192
+
+// Offset of the CRLF ending the line at buf[pos, len): -1 if incomplete, -2 for a bare LF
+static long find_line_end(const char* buf, size_t pos, size_t len) {
+    const char* lf = memchr(buf + pos, '\n', len - pos);
+    if (!lf) return -1;
+    if (lf == buf + pos || lf[-1] != '\r') return -2;
+    return (lf - 1) - buf;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Trailer fields are kept like headers, except ones that would change the framing.
+// Returns -1 once the fields no longer fit in req->headers.
+static int add_trailer(HttpRequest* req, const char* line, size_t len) {
+    const char* colon = memchr(line, ':', len);
+    if (!colon || colon == line) return 0;
+    size_t key_len = colon - line;
+    if ((key_len == 14 && strncasecmp(line, "Content-Length", 14) == 0) ||
+        (key_len == 17 && strncasecmp(line, "Transfer-Encoding", 17) == 0) ||
+        (key_len == 4 && strncasecmp(line, "Host", 4) == 0)) {
+        return 0;
+    }
+    if (req->header_count >= MAX_HEADERS) return -1;
+    const char* value = colon + 1;
+    while (value < line + len && (*value == ' ' || *value == '\t')) value++;
+    req->headers[req->header_count].key = arena_strndup(&req->arena, line, key_len);
+    req->headers[req->header_count].value = arena_strndup(&req->arena, value, line + len - value);
+    req->header_count++;
+    return 0;
+}
+
+int http_chunked_decode(HttpRequest* req, char* buf, size_t len, size_t* in, size_t* out) {
+    size_t pos = *in;
+    size_t dst = *out;
+    int rc = 0;
+    bool more = true;
+
+    while (more && rc == 0) {
+        switch (req->chunk_state) {
+            case CHUNK_STATE_SIZE: {
+                long eol = find_line_end(buf, pos, len);
+                if (eol == -1) {
+                    if (len - pos > CHUNK_LINE_MAX) rc = -1;
+                    more = false;
+                    break;
+                }
+                if (eol == -2 || (size_t)eol - pos > CHUNK_LINE_MAX) {
+                    rc = -1;
+                    break;
+                }
+                size_t size = 0;
+                size_t p = pos;
+                int digit;
+                while (p < (size_t)eol && (digit = hex_value(buf[p])) >= 0) {
+                    if (size > (SIZE_MAX >> 4)) {
+                        return -1;
+                    }
+                    size = (size << 4) | (size_t)digit;
+                    p++;
+                }
+                if (p == pos) { // No hex digits
+                    rc = -1;
+                    break;
+                }
+                // Optional whitespace, then either the end of the line or
+                // chunk extensions (";name=value"), which carry nothing we use
+                while (p < (size_t)eol && (buf[p] == ' ' || buf[p] == '\t')) p++;
+                if (p < (size_t)eol && buf[p] != ';') {
+                    rc = -1;
+                    break;
+                }
+                pos = eol + 2;
+                req->chunk_remaining = size;
+                req->chunk_state = size ? CHUNK_STATE_DATA : CHUNK_STATE_TRAILER;
+                break;
+            }
+            case CHUNK_STATE_DATA: {
+                size_t take = len - pos;
+                if (take > req->chunk_remaining) take = req->chunk_remaining;
+                if (take == 0) {
+                    more = false;
+                    break;
+                }
+                if (dst != pos) {
+                    memmove(buf + dst, buf + pos, take);
+                }
+                dst += take;
+                pos += take;
+                req->chunk_remaining -= take;
+                if (req->chunk_remaining == 0) {
+                    req->chunk_state = CHUNK_STATE_DATA_END;
+                }
+                break;
+            }
+            case CHUNK_STATE_DATA_END:
+                if (len - pos < 2) {
+                    more = false;
+                    break;
+                }
+                if (buf[pos] != '\r' || buf[pos + 1] != '\n') {
+                    rc = -1;
+                    break;
+                }
+                pos += 2;
+                req->chunk_state = CHUNK_STATE_SIZE;
+                break;
+            case CHUNK_STATE_TRAILER: {
+                long eol = find_line_end(buf, pos, len);
+                if (eol == -1) {
+                    if (len - pos > TRAILER_LINE_MAX) rc = -1;
+                    more = false;
+                    break;
+                }
+                if (eol == -2 || (size_t)eol - pos > TRAILER_LINE_MAX) {
+                    rc = -1;
+                    break;
+                }
+                req->trailer_bytes += (size_t)eol - pos + 2;
+                if (req->trailer_bytes > MAX_HEADER_SIZE) {
+                    rc = -1;
+                    break;
+                }
+                if ((size_t)eol > pos) {
+                    if (add_trailer(req, buf + pos, eol - pos) != 0) {
+                        rc = -1;
+                        break;
+                    }
+                } else {
+                    req->chunk_state = CHUNK_STATE_DONE;
+                }
+                pos = eol + 2;
+                break;
+            }
+            case CHUNK_STATE_DONE:
+                rc = 1;
+                break;
         }
-        // Free pre-parsed body parameters (Phase 2)
-        for (int i = 0; i < req->body_param_count; i++) {
-            free(req->body_params[i].key);
-            free(req->body_params[i].value);
+    }
+
+    *in = pos;
+    *out = dst;
+    return rc;
+}
+
+// ============================================================================
+// Static file resolution
+// ============================================================================
+
+static int docroot_fd = -1;            // DocumentRoot, O_PATH
+static bool openat2_unsupported = false;
+
+int http_static_init(const ServerConfig* config) {
+    if (docroot_fd != -1) {
+        close(docroot_fd);
+    }
+    docroot_fd = open(config->document_root, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (docroot_fd == -1) {
+        log_system(LOG_ERROR, "Static: Cannot open DocumentRoot '%s': %s", config->document_root, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// Drops "." and empty components and applies ".." lexically, in place.
+// Returns false if ".." would climb above the root.
+static bool normalise_path(char* path) {
+    size_t out = 0;
+    char* p = path;
+    while (*p) {
+        size_t len = strcspn(p, "/");
+        if (len == 2 && p[0] == '.' && p[1] == '.') {
+            if (out == 0) return false;
+            while (out > 0 && path[out - 1] != '/') out--;
+            if (out > 0) out--; // The separator before the dropped component
+        } else if (len > 0 && !(len == 1 && p[0] == '.')) {
+            if (out > 0) path[out++] = '/';
+            memmove(path + out, p, len);
+            out += len;
         }
-        // Free JSON document (Phase 3)
-        if (req->json_doc) {
-            yyjson_doc_free(req->json_doc);
+        p += len;
+        if (*p == '/') p++;
+    }
+    path[out] = '\0';
+    return true;
+}
+
+// Opens a path relative to DocumentRoot for reading. Returns the fd, or -1
+// with errno set; EXDEV means the path resolves outside DocumentRoot.
+static int open_beneath(char* path) {
+#ifdef SYS_openat2
+    if (!openat2_unsupported) {
+        struct open_how how;
+        memset(&how, 0, sizeof(how));
+        how.flags = O_RDONLY | O_CLOEXEC;
+        how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+        int fd = (int)syscall(SYS_openat2, docroot_fd, path, &how, sizeof(how));
+        if (fd != -1 || errno != ENOSYS) {
+            return fd;
         }
-        // Use memset to be safe, especially since this struct is part of another struct
-        memset(req, 0, sizeof(HttpRequest));
+        openat2_unsupported = true;
+        log_system(LOG_WARNING, "Static: openat2() unavailable, falling back to openat() with path normalisation.");
+    }
+#endif
+    // Lexical check only: symlinks inside DocumentRoot are still followed
+    if (!normalise_path(path)) {
+        errno = EXDEV;
+        return -1;
     }
+    return openat(docroot_fd, path[0] ? path : ".", O_RDONLY | O_CLOEXEC);
 }
 
 void handleStaticRequest(Connection* conn, const ServerConfig* config, int epollFd) {
     const char* method = conn->request.method;
     const char* uri = conn->request.uri;
+    const char* raw_uri = conn->request.raw_uri; // Undecoded, as sent, for the access log
     
     if (strcasecmp(method, "GET") != 0 && strcasecmp(method, "HEAD") != 0) {
         log_system(LOG_DEBUG, "Static: Received unsupported method '%s' for URI '%s'", method, uri);
-        char response[] = "HTTP/1.1 501 Not Implemented\r\n\r\nNot Implemented";
-        queue_data_for_writing(conn, response, sizeof(response) - 1, epollFd);
-        log_access(conn->client_ip, method, conn->request.raw_uri, 501);
+        http_send_error(conn, 501, NULL, epollFd);
+        log_access(conn->client_ip, method, raw_uri, 501);
         return;
     }
     log_system(LOG_DEBUG, "Static: Handling %s request for URI '%s'", method, uri);
 
-    char path[MAX_PATH_LEN];
-
-    if (strcmp(uri, "/") == 0) {
-        snprintf(path, sizeof(path), "%s/index.html", config->document_root);
-    } else {
-        snprintf(path, sizeof(path), "%s%s", config->document_root, uri);
+    // Relative to DocumentRoot; the kernel keeps the resolution beneath it
+    char path[PATH_MAX];
+    const char* rel = uri + strspn(uri, "/");
+    if (*rel == '\0') {
+        rel = "index.html";
     }
-    log_system(LOG_DEBUG, "Static: Resolved file path to '%s'", path);
-
-    // Security check: simple but effective check for path traversal.
-    if (strstr(path, "../") != NULL) {
-        log_system(LOG_WARNING, "Static: Path traversal attempt blocked for URI '%s'", uri);
-        log_access(conn->client_ip, method, uri, 403);
-        char response[] = "HTTP/1.1 403 Forbidden\r\n\r\nForbidden";
-        queue_data_for_writing(conn, response, sizeof(response) - 1, epollFd);
+    size_t rel_len = strlen(rel);
+    if (rel_len >= sizeof(path)) {
+        log_access(conn->client_ip, method, raw_uri, 414);
+        http_send_error(conn, 414, NULL, epollFd);
         return;
     }
+    memcpy(path, rel, rel_len + 1);
 
-    int fileFd = open(path, O_RDONLY);
+    int fileFd = -1;
+    if (docroot_fd == -1) {
+        errno = ENOENT; // http_static_init() failed or was not called
+    } else {
+        fileFd = open_beneath(path);
+    }
     if (fileFd == -1) {
         log_system(LOG_DEBUG, "Static: Failed to open file '%s'. errno: %d (%s)", path, errno, strerror(errno));
-        if (errno == ENOENT) {
-            log_access(conn->client_ip, method, uri, 404);
-            char response[] = "HTTP/1.1 404 Not Found\r\n\r\nNot Found";
-            queue_data_for_writing(conn, response, sizeof(response) - 1, epollFd);
+        if (errno == EXDEV) {
+            log_system_rl(LOG_WARNING, "Static: Path traversal attempt blocked for URI '%s'", uri);
+        }
+        if (errno == ENOENT || errno == ENOTDIR) {
+            log_access(conn->client_ip, method, raw_uri, 404);
+            http_send_error(conn, 404, NULL, epollFd);
         } else {
-            log_access(conn->client_ip, method, uri, 403);
-            char response[] = "HTTP/1.1 403 Forbidden\r\n\r\nForbidden";
-            queue_data_for_writing(conn, response, sizeof(response) - 1, epollFd);
+            log_access(conn->client_ip, method, raw_uri, 403);
+            http_send_error(conn, 403, NULL, epollFd);
         }
         return;
     }
@@ -125,34 +338,45 @@ void handleStaticRequest(Connection* conn, const ServerConfig* config, int epoll
         log_system(LOG_ERROR, "fstat error on %s: %s", path, strerror(errno));
         close(fileFd);
         // Let's send a 500 error to the client
-        char response[] = "HTTP/1.1 500 Internal Server Error\r\n\r\nInternal Server Error";
-        queue_data_for_writing(conn, response, sizeof(response) - 1, epollFd);
-        log_access(conn->client_ip, method, uri, 500);
+        http_send_error(conn, 500, NULL, epollFd);
+        log_access(conn->client_ip, method, raw_uri, 500);
+        return;
+    }
+    if (!S_ISREG(fileStat.st_mode)) {
+        // Directories and devices open fine but have nothing to serve
+        close(fileFd);
+        log_access(conn->client_ip, method, raw_uri, 404);
+        http_send_error(conn, 404, NULL, epollFd);
         return;
     }
 
-    log_access(conn->client_ip, method, uri, 200);
+    log_access(conn->client_ip, method, raw_uri, 200);
 
-    const char* mime_type = config->mime_enabled ? getMimeType(path) : "application/octet-stream";
-    log_system(LOG_DEBUG, "Static: Serving file '%s' (%ld bytes) with MIME type '%s'", path, fileStat.st_size, mime_type);
+    const MimeType* mime = config->mime_enabled ? mime_lookup(path) : mime_default();
+    log_system(LOG_DEBUG, "Static: Serving file '%s' (%ld bytes) with MIME type '%s'", path, fileStat.st_size, mime->type);
 
     char header[512];
     int headerLen = snprintf(header, sizeof(header),
                              "HTTP/1.1 200 OK\r\n"
-                             ""
-                             "Content-Type: %s\r\n"
+                             "%.*s"
                              "Content-Length: %ld\r\n\r\n",
-                             mime_type, 
+                             (int)mime->header_len, mime->header,
                              fileStat.st_size);
     queue_data_for_writing(conn, header, headerLen, epollFd);
 
     // For HEAD requests, we only send the header.
     if (strcasecmp(method, "GET") == 0) {
-        // Send file content
-        char buffer[4096];
-        ssize_t bytesRead;
-        while ((bytesRead = read(fileFd, buffer, sizeof(buffer))) > 0) {
-            queue_data_for_writing(conn, buffer, bytesRead, epollFd);
+        // Larger files are sent from a mapping shared with every other connection
+        FileMapping* map = file_cache_wants((size_t)fileStat.st_size) ? file_cache_acquire(fileFd, &fileStat) : NULL;
+        if (map) {
+            queue_mapping_for_writing(conn, map, 0, file_cache_size(map), epollFd);
+        } else {
+            // Send file content
+            char buffer[4096];
+            ssize_t bytesRead;
+            while ((bytesRead = read(fileFd, buffer, sizeof(buffer))) > 0) {
+                queue_data_for_writing(conn, buffer, bytesRead, epollFd);
+            }
         }
     }
 
@@ -0,0 +1,435 @@
+#include "json_schema.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+#define MAX_OBJECT_PROPS 64 // Required properties are tracked in a uint64_t
+
+enum {
+    T_OBJECT = 1 << 0,
+    T_ARRAY = 1 << 1,
+    T_STRING = 1 << 2,
+    T_INTEGER = 1 << 3,
+    T_NUMBER = 1 << 4,   // Integers included
+    T_BOOLEAN = 1 << 5,
+    T_NULL = 1 << 6,
+};
+
+enum {
+    F_MINIMUM = 1 << 0,
+    F_MAXIMUM = 1 << 1,
+    F_NO_ADDITIONAL = 1 << 2,
+};
+
+typedef struct {
+    uint8_t types;       // T_* mask, 0 = any
+    uint8_t flags;       // F_*
+    double minimum, maximum;
+    size_t min_len, max_len; // String code points or array items
+    int items;           // Node for array elements, -1 = unchecked
+    int prop_first, prop_count;
+    int enum_first, enum_count;
+    uint64_t required;   // Bit i = props[prop_first + i] is required
+} SchemaNode;
+
+typedef struct {
+    const char* key;     // Points into the schema document
+    size_t key_len;
+    uint32_t hash;
+    int node;
+} SchemaProp;
+
+struct JsonSchema {
+    SchemaNode* nodes;
+    int node_count;
+    SchemaProp* props;
+    int prop_count;
+    yyjson_val** enums;
+    int enum_count;
+    yyjson_doc* doc;     // Keeps keys and enum values alive
+};
+
+// FNV-1a
+static uint32_t key_hash(const char* key, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void set_err(char* err, size_t err_len, const char* fmt, ...) {
+    if (!err || err_len == 0) return;
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(err, err_len, fmt, ap);
+    va_end(ap);
+}
+
+// ============================================================================
+// Compilation
+// ============================================================================
+
+static int type_bit(yyjson_val* name) {
+    static const struct { const char* name; int bit; } TYPES[] = {
+        { "object", T_OBJECT }, { "array", T_ARRAY }, { "string", T_STRING },
+        { "integer", T_INTEGER }, { "number", T_NUMBER }, { "boolean", T_BOOLEAN },
+        { "null", T_NULL },
+    };
+    for (size_t i = 0; i < sizeof(TYPES) / sizeof(TYPES[0]); i++) {
+        if (yyjson_equals_str(name, TYPES[i].name)) return TYPES[i].bit;
+    }
+    return 0;
+}
+
+static bool is_annotation(yyjson_val* key) {
+    static const char* NAMES[] = { "$schema", "$id", "title", "description", "default", "examples" };
+    for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+        if (yyjson_equals_str(key, NAMES[i])) return true;
+    }
+    return false;
+}
+
+static bool get_count(yyjson_val* val, size_t* out) {
+    if (!yyjson_is_uint(val) && !(yyjson_is_sint(val) && yyjson_get_sint(val) >= 0)) return false;
+    *out = (size_t)yyjson_get_uint(val);
+    return true;
+}
+
+// Appends the node for `def` and returns its index, or -1 (err set)
+static int compile_node(JsonSchema* s, yyjson_val* def, int depth, char* err, size_t err_len) {
+    if (!yyjson_is_obj(def)) {
+        set_err(err, err_len, "schema must be an object");
+        return -1;
+    }
+    if (depth > 32) {
+        set_err(err, err_len, "schema nested too deeply");
+        return -1;
+    }
+
+    SchemaNode node;
+    memset(&node, 0, sizeof(node));
+    node.min_len = 0;
+    node.max_len = SIZE_MAX;
+    node.items = -1;
+
+    int index = s->node_count;
+    SchemaNode* grown = realloc(s->nodes, (s->node_count + 1) * sizeof(SchemaNode));
+    if (!grown) {
+        set_err(err, err_len, "out of memory");
+        return -1;
+    }
+    s->nodes = grown;
+    s->node_count++;
+
+    yyjson_val* properties = NULL;
+    yyjson_val* required = NULL;
+    yyjson_val *key, *val;
+    yyjson_obj_iter iter = yyjson_obj_iter_with(def);
+    while ((key = yyjson_obj_iter_next(&iter))) {
+        val = yyjson_obj_iter_get_val(key);
+        const char* k = yyjson_get_str(key);
+        if (strcmp(k, "type") == 0) {
+            if (yyjson_is_str(val)) {
+                node.types = type_bit(val);
+                if (!node.types) goto bad;
+            } else if (yyjson_is_arr(val)) {
+                yyjson_val* t;
+                yyjson_arr_iter ai = yyjson_arr_iter_with(val);
+                while ((t = yyjson_arr_iter_next(&ai))) {
+                    int bit = type_bit(t);
+                    if (!bit) goto bad;
+                    node.types |= bit;
+                }
+            } else {
+                goto bad;
+            }
+        } else if (strcmp(k, "properties") == 0) {
+            if (!yyjson_is_obj(val)) goto bad;
+            properties = val;
+        } else if (strcmp(k, "required") == 0) {
+            if (!yyjson_is_arr(val)) goto bad;
+            required = val;
+        } else if (strcmp(k, "additionalProperties") == 0) {
+            if (!yyjson_is_bool(val)) goto bad;
+            if (!yyjson_get_bool(val)) node.flags |= F_NO_ADDITIONAL;
+        } else if (strcmp(k, "items") == 0) {
+            // Filled in below, after this node is stored
+        } else if (strcmp(k, "minLength") == 0 || strcmp(k, "minItems") == 0) {
+            if (!get_count(val, &node.min_len)) goto bad;
+        } else if (strcmp(k, "maxLength") == 0 || strcmp(k, "maxItems") == 0) {
+            if (!get_count(val, &node.max_len)) goto bad;
+        } else if (strcmp(k, "minimum") == 0) {
+            if (!yyjson_is_num(val)) goto bad;
+            node.minimum = yyjson_get_num(val);
+            node.flags |= F_MINIMUM;
+        } else if (strcmp(k, "maximum") == 0) {
+            if (!yyjson_is_num(val)) goto bad;
+            node.maximum = yyjson_get_num(val);
+            node.flags |= F_MAXIMUM;
+        } else if (strcmp(k, "enum") == 0) {
+            if (!yyjson_is_arr(val) || yyjson_arr_size(val) == 0) goto bad;
+            size_t n = yyjson_arr_size(val);
+            yyjson_val** enums = realloc(s->enums, (s->enum_count + n) * sizeof(yyjson_val*));
+            if (!enums) goto oom;
+            s->enums = enums;
+            node.enum_first = s->enum_count;
+            node.enum_count = (int)n;
+            yyjson_val* e;
+            yyjson_arr_iter ai = yyjson_arr_iter_with(val);
+            while ((e = yyjson_arr_iter_next(&ai))) {
+                if (yyjson_is_ctn(e)) goto bad;
+                s->enums[s->enum_count++] = e;
+            }
+        } else if (!is_annotation(key)) {
+            set_err(err, err_len, "unsupported keyword '%s'", k);
+            return -1;
+        }
+    }
+
+    // Properties: reserve a contiguous slice, then compile the subschemas
+    if (properties) {
+        size_t n = yyjson_obj_size(properties);
+        if (n > MAX_OBJECT_PROPS) {
+            set_err(err, err_len, "more than %d properties in one object", MAX_OBJECT_PROPS);
+            return -1;
+        }
+        SchemaProp* props = realloc(s->props, (s->prop_count + n) * sizeof(SchemaProp));
+        if (!props) goto oom;
+        s->props = props;
+        node.prop_first = s->prop_count;
+        node.prop_count = (int)n;
+        s->prop_count += (int)n;
+        int i = 0;
+        iter = yyjson_obj_iter_with(properties);
+        while ((key = yyjson_obj_iter_next(&iter))) {
+            int child = compile_node(s, yyjson_obj_iter_get_val(key), depth + 1, err, err_len);
+            if (child < 0) return -1;
+            SchemaProp* p = &s->props[node.prop_first + i++];
+            p->key = yyjson_get_str(key);
+            p->key_len = yyjson_get_len(key);
+            p->hash = key_hash(p->key, p->key_len);
+            p->node = child;
+        }
+    }
+    if (required) {
+        yyjson_val* r;
+        yyjson_arr_iter ai = yyjson_arr_iter_with(required);
+        while ((r = yyjson_arr_iter_next(&ai))) {
+            int i = 0;
+            while (i < node.prop_count &&
+                   !yyjson_equals_strn(r, s->props[node.prop_first + i].key, s->props[node.prop_first + i].key_len)) {
+                i++;
+            }
+            if (i == node.prop_count) {
+                set_err(err, err_len, "required property '%s' is not in properties",
+                        yyjson_is_str(r) ? yyjson_get_str(r) : "?");
+                return -1;
+            }
+            node.required |= (uint64_t)1 << i;
+        }
+    }
+    yyjson_val* items = yyjson_obj_get(def, "items");
+    if (items) {
+        node.items = compile_node(s, items, depth + 1, err, err_len);
+        if (node.items < 0) return -1;
+    }
+
+    s->nodes[index] = node;
+    return index;
+
+bad:
+    set_err(err, err_len, "invalid value for '%s'", yyjson_get_str(key));
+    return -1;
+oom:
+    set_err(err, err_len, "out of memory");
+    return -1;
+}
+
+JsonSchema* json_schema_compile(const char* schema_json, char* err, size_t err_len) {
+    if (!schema_json) {
+        set_err(err, err_len, "no schema");
+        return NULL;
+    }
+    yyjson_read_err read_err;
+    yyjson_doc* doc = yyjson_read_opts((char*)schema_json, strlen(schema_json), 0, NULL, &read_err);
+    if (!doc) {
+        set_err(err, err_len, "schema is not valid JSON at byte %zu: %s", read_err.pos, read_err.msg);
+        return NULL;
+    }
+    JsonSchema* s = calloc(1, sizeof(JsonSchema));
+    if (!s) {
+        yyjson_doc_free(doc);
+        set_err(err, err_len, "out of memory");
+        return NULL;
+    }
+    s->doc = doc;
+    if (compile_node(s, yyjson_doc_get_root(doc), 0, err, err_len) < 0) {
+        json_schema_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void json_schema_free(JsonSchema* schema) {
+    if (!schema) return;
+    free(schema->nodes);
+    free(schema->props);
+    free(schema->enums);
+    yyjson_doc_free(schema->doc);
+    free(schema);
+}
+
+// ============================================================================
+// Validation
+// ============================================================================
+
+typedef struct {
+    char* err;
+    size_t err_len;
+    char path[256];      // "$.a.b[3]"
+    size_t path_len;
+} Validation;
+
+static int fail(Validation* v, const char* fmt, ...) {
+    if (!v->err || v->err_len == 0) return -1;
+    int n = snprintf(v->err, v->err_len, "%s: ", v->path);
+    if (n >= 0 && (size_t)n < v->err_len) {
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(v->err + n, v->err_len - n, fmt, ap);
+        va_end(ap);
+    }
+    return -1;
+}
+
+static size_t utf8_length(const char* str, size_t len) {
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (((unsigned char)str[i] & 0xC0) != 0x80) count++;
+    }
+    return count;
+}
+
+static int validate_node(const JsonSchema* s, int index, yyjson_val* val, Validation* v);
+
+static int validate_object(const JsonSchema* s, const SchemaNode* node, yyjson_val* val, Validation* v) {
+    uint64_t seen = 0;
+    size_t saved_len = v->path_len;
+    yyjson_val *key, *member;
+    yyjson_obj_iter iter = yyjson_obj_iter_with(val);
+    while ((key = yyjson_obj_iter_next(&iter))) {
+        const char* k = yyjson_get_str(key);
+        size_t k_len = yyjson_get_len(key);
+        uint32_t h = key_hash(k, k_len);
+        int i = 0;
+        for (; i < node->prop_count; i++) {
+            const SchemaProp* p = &s->props[node->prop_first + i];
+            if (p->hash == h && p->key_len == k_len && memcmp(p->key, k, k_len) == 0) break;
+        }
+        if (i == node->prop_count) {
+            if (node->flags & F_NO_ADDITIONAL) {
+                return fail(v, "unexpected property '%.*s'", (int)k_len, k);
+            }
+            continue;
+        }
+        seen |= (uint64_t)1 << i;
+        member = yyjson_obj_iter_get_val(key);
+        int n = snprintf(v->path + saved_len, sizeof(v->path) - saved_len, ".%.*s", (int)k_len, k);
+        v->path_len = (n > 0 && saved_len + n < sizeof(v->path)) ? saved_len + n : sizeof(v->path) - 1;
+        int rc = validate_node(s, s->props[node->prop_first + i].node, member, v);
+        v->path_len = saved_len;
+        v->path[saved_len] = '\0';
+        if (rc != 0) return rc;
+    }
+    uint64_t missing = node->required & ~seen;
+    if (missing) {
+        int i = __builtin_ctzll(missing);
+        const SchemaProp* p = &s->props[node->prop_first + i];
+        return fail(v, "missing required property '%.*s'", (int)p->key_len, p->key);
+    }
+    return 0;
+}
+
+static int validate_array(const JsonSchema* s, const SchemaNode* node, yyjson_val* val, Validation* v) {
+    size_t n = yyjson_arr_size(val);
+    if (n < node->min_len) return fail(v, "must have at least %zu items", node->min_len);
+    if (n > node->max_len) return fail(v, "must have at most %zu items", node->max_len);
+    if (node->items < 0) return 0;
+
+    size_t saved_len = v->path_len;
+    size_t idx = 0;
+    yyjson_val* item;
+    yyjson_arr_iter iter = yyjson_arr_iter_with(val);
+    while ((item = yyjson_arr_iter_next(&iter))) {
+        int w = snprintf(v->path + saved_len, sizeof(v->path) - saved_len, "[%zu]", idx++);
+        v->path_len = (w > 0 && saved_len + w < sizeof(v->path)) ? saved_len + w : sizeof(v->path) - 1;
+        int rc = validate_node(s, node->items, item, v);
+        v->path_len = saved_len;
+        v->path[saved_len] = '\0';
+        if (rc != 0) return rc;
+    }
+    return 0;
+}
+
+static int validate_node(const JsonSchema* s, int index, yyjson_val* val, Validation* v) {
+    const SchemaNode* node = &s->nodes[index];
+
+    int type;
+    switch (yyjson_get_type(val)) {
+        case YYJSON_TYPE_OBJ: type = T_OBJECT; break;
+        case YYJSON_TYPE_ARR: type = T_ARRAY; break;
+        case YYJSON_TYPE_STR: type = T_STRING; break;
+        case YYJSON_TYPE_NUM: type = yyjson_is_real(val) ? T_NUMBER : T_INTEGER | T_NUMBER; break;
+        case YYJSON_TYPE_BOOL: type = T_BOOLEAN; break;
+        case YYJSON_TYPE_NULL: type = T_NULL; break;
+        default: return fail(v, "unsupported value");
+    }
+    if (node->types && !(node->types & type)) {
+        return fail(v, "wrong type (%s)", yyjson_get_type_desc(val));
+    }
+
+    if (node->enum_count > 0) {
+        int i = 0;
+        while (i < node->enum_count && !yyjson_equals(s->enums[node->enum_first + i], val)) i++;
+        if (i == node->enum_count) return fail(v, "not one of the allowed values");
+    }
+
+    switch (type & ~T_NUMBER) {
+        case T_OBJECT:
+            return validate_object(s, node, val, v);
+        case T_ARRAY:
+            return validate_array(s, node, val, v);
+        case T_STRING: {
+            size_t len = utf8_length(yyjson_get_str(val), yyjson_get_len(val));
+            if (len < node->min_len) return fail(v, "must be at least %zu characters", node->min_len);
+            if (len > node->max_len) return fail(v, "must be at most %zu characters", node->max_len);
+            return 0;
+        }
+        default:
+            break;
+    }
+    if (type & T_NUMBER) {
+        double num = yyjson_get_num(val);
+        if ((node->flags & F_MINIMUM) && num < node->minimum) return fail(v, "must be >= %g", node->minimum);
+        if ((node->flags & F_MAXIMUM) && num > node->maximum) return fail(v, "must be <= %g", node->maximum);
+    }
+    return 0;
+}
+
+int json_schema_validate(const JsonSchema* schema, yyjson_val* value, char* err, size_t err_len) {
+    if (!schema || schema->node_count == 0) return 0;
+    Validation v;
+    v.err = err;
+    v.err_len = err_len;
+    strcpy(v.path, "$");
+    v.path_len = 1;
+    if (!value) {
+        return fail(&v, "no value");
+    }
+    return validate_node(schema, 0, value, &v);
+}
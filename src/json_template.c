@@ -0,0 +1,238 @@
+#include "json_template.h"
+#include "logger.h"
+#include "yyjson.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MAX_SLOT_NAME 32
+
+typedef struct {
+    JsonTplSlotType type;
+    size_t at;               // Offset in the literal text where the value goes
+    char name[MAX_SLOT_NAME];
+} TplSlot;
+
+struct JsonTemplate {
+    char* literal;           // The skeleton without placeholders and whitespace
+    size_t literal_len;
+    TplSlot* slots;
+    int slot_count;
+};
+
+static const struct {
+    const char* name;
+    JsonTplSlotType type;
+} SLOT_TYPES[] = {
+    { "str", JSON_TPL_SLOT_STR }, { "int", JSON_TPL_SLOT_INT }, { "num", JSON_TPL_SLOT_NUM },
+    { "bool", JSON_TPL_SLOT_BOOL }, { "raw", JSON_TPL_SLOT_RAW },
+};
+
+static bool is_name_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Parses "name:type}}" at p into slot. Returns the length consumed, or 0.
+static size_t parse_placeholder(const char* p, TplSlot* slot) {
+    size_t n = 0;
+    while (is_name_char(p[n])) n++;
+    if (n == 0 || n >= MAX_SLOT_NAME || p[n] != ':') return 0;
+    memcpy(slot->name, p, n);
+    slot->name[n] = '\0';
+    const char* type = p + n + 1;
+    for (size_t i = 0; i < sizeof(SLOT_TYPES) / sizeof(SLOT_TYPES[0]); i++) {
+        size_t len = strlen(SLOT_TYPES[i].name);
+        if (strncmp(type, SLOT_TYPES[i].name, len) == 0 && type[len] == '}' && type[len + 1] == '}') {
+            slot->type = SLOT_TYPES[i].type;
+            return n + 1 + len + 2;
+        }
+    }
+    return 0;
+}
+
+JsonTemplate* json_template_compile(const char* skeleton) {
+    if (!skeleton) return NULL;
+    size_t len = strlen(skeleton);
+    JsonTemplate* tpl = calloc(1, sizeof(JsonTemplate));
+    char* check = malloc(len + 1); // The skeleton with null for each slot, for validation
+    if (!tpl || !check || !(tpl->literal = malloc(len + 1))) {
+        log_system(LOG_ERROR, "JSON template: Out of memory");
+        free(check);
+        json_template_free(tpl);
+        return NULL;
+    }
+
+    size_t out = 0, check_len = 0;
+    bool in_string = false;
+    for (size_t i = 0; i < len; i++) {
+        char c = skeleton[i];
+        if (in_string) {
+            if (c == '\\' && i + 1 < len) {
+                tpl->literal[out++] = c;
+                check[check_len++] = c;
+                c = skeleton[++i];
+            } else if (c == '"') {
+                in_string = false;
+            }
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            continue;
+        } else if (c == '{' && skeleton[i + 1] == '{') {
+            TplSlot slot;
+            size_t n = parse_placeholder(skeleton + i + 2, &slot);
+            if (n == 0) {
+                log_system(LOG_ERROR, "JSON template: Bad placeholder at byte %zu (expected {{name:str|int|num|bool|raw}})", i);
+                goto fail;
+            }
+            if (json_template_slot_index(tpl, slot.name) >= 0) {
+                log_system(LOG_ERROR, "JSON template: Duplicate placeholder '%s'", slot.name);
+                goto fail;
+            }
+            TplSlot* slots = realloc(tpl->slots, (tpl->slot_count + 1) * sizeof(TplSlot));
+            if (!slots) goto fail;
+            slot.at = out;
+            tpl->slots = slots;
+            tpl->slots[tpl->slot_count++] = slot;
+            memcpy(check + check_len, "null", 4); // Shorter than any placeholder
+            check_len += 4;
+            i += 2 + n - 1;
+            continue;
+        } else if (c == '"') {
+            in_string = true;
+        }
+        tpl->literal[out++] = c;
+        check[check_len++] = c;
+    }
+    tpl->literal_len = out;
+
+    yyjson_read_err err;
+    yyjson_doc* doc = yyjson_read_opts(check, check_len, 0, NULL, &err);
+    if (!doc) {
+        log_system(LOG_ERROR, "JSON template: Invalid skeleton (%s at byte %zu of the compacted text)", err.msg, err.pos);
+        goto fail;
+    }
+    yyjson_doc_free(doc);
+    free(check);
+    return tpl;
+
+fail:
+    free(check);
+    json_template_free(tpl);
+    return NULL;
+}
+
+void json_template_free(JsonTemplate* tpl) {
+    if (!tpl) return;
+    free(tpl->literal);
+    free(tpl->slots);
+    free(tpl);
+}
+
+int json_template_slot_count(const JsonTemplate* tpl) {
+    return tpl ? tpl->slot_count : 0;
+}
+
+int json_template_slot_index(const JsonTemplate* tpl, const char* name) {
+    if (!tpl || !name) return -1;
+    for (int i = 0; i < tpl->slot_count; i++) {
+        if (strcmp(tpl->slots[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+size_t json_template_max_size(const JsonTemplate* tpl, const JsonTplValue* values) {
+    size_t size = tpl->literal_len;
+    for (int i = 0; i < tpl->slot_count; i++) {
+        const JsonTplValue* v = &values[i];
+        switch (tpl->slots[i].type) {
+            case JSON_TPL_SLOT_STR: size += v->str ? 2 + 6 * v->len : 4; break; // \u00XX worst case
+            case JSON_TPL_SLOT_INT: size += 21; break;
+            case JSON_TPL_SLOT_NUM: size += 40; break; // yyjson_write_number()'s bound
+            case JSON_TPL_SLOT_BOOL: size += 5; break;
+            case JSON_TPL_SLOT_RAW: size += v->str ? v->len : 4; break;
+        }
+    }
+    return size;
+}
+
+// Escapes str as a quoted JSON string. Runs that need no escaping are copied whole.
+static char* write_string(char* out, const char* str, size_t len) {
+    static const char HEX[] = "0123456789abcdef";
+    *out++ = '"';
+    size_t run = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)str[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        memcpy(out, str + run, i - run);
+        out += i - run;
+        run = i + 1;
+        *out++ = '\\';
+        switch (c) {
+            case '"': *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '\n': *out++ = 'n'; break;
+            case '\r': *out++ = 'r'; break;
+            case '\t': *out++ = 't'; break;
+            case '\b': *out++ = 'b'; break;
+            case '\f': *out++ = 'f'; break;
+            default:
+                memcpy(out, "u00", 3);
+                out[3] = HEX[c >> 4];
+                out[4] = HEX[c & 0xF];
+                out += 5;
+                break;
+        }
+    }
+    memcpy(out, str + run, len - run);
+    out += len - run;
+    *out++ = '"';
+    return out;
+}
+
+size_t json_template_render(const JsonTemplate* tpl, const JsonTplValue* values, char* out) {
+    char* p = out;
+    size_t from = 0;
+    for (int i = 0; i < tpl->slot_count; i++) {
+        const TplSlot* slot = &tpl->slots[i];
+        const JsonTplValue* v = &values[i];
+        memcpy(p, tpl->literal + from, slot->at - from);
+        p += slot->at - from;
+        from = slot->at;
+
+        yyjson_mut_val num;
+        switch (slot->type) {
+            case JSON_TPL_SLOT_STR:
+                if (v->str) {
+                    p = write_string(p, v->str, v->len);
+                    continue;
+                }
+                break;
+            case JSON_TPL_SLOT_RAW:
+                if (v->str) {
+                    memcpy(p, v->str, v->len);
+                    p += v->len;
+                    continue;
+                }
+                break;
+            case JSON_TPL_SLOT_INT:
+                yyjson_mut_set_sint(&num, v->i);
+                p = yyjson_mut_write_number(&num, p);
+                continue;
+            case JSON_TPL_SLOT_NUM:
+                if (isfinite(v->num)) {
+                    yyjson_mut_set_real(&num, v->num);
+                    p = yyjson_mut_write_number(&num, p);
+                    continue;
+                }
+                break;
+            case JSON_TPL_SLOT_BOOL:
+                memcpy(p, v->b ? "true" : "false", v->b ? 4 : 5);
+                p += v->b ? 4 : 5;
+                continue;
+        }
+        memcpy(p, "null", 4);
+        p += 4;
+    }
+    memcpy(p, tpl->literal + from, tpl->literal_len - from);
+    p += tpl->literal_len - from;
+    return (size_t)(p - out);
+}
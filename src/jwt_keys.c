@@ -0,0 +1,517 @@
+#define _DEFAULT_SOURCE // For strdup
+#include "jwt_keys.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <l8w8jwt/decode.h> // L8W8JWT_ALG_* constants
+#include <mbedtls/pk.h>
+#include <mbedtls/md.h>
+#include "yyjson.h"
+#include "logger.h"
+
+// ============================================================================
+// Design
+// ============================================================================
+// Key files are read once at startup. RSA and EC keys, from PEM files or JWKS,
+// are kept as PEM text: mbedtls parses it natively and l8w8jwt takes it as-is.
+// Parsing a public key is expensive, so every thread parses a key on first use
+// and keeps the mbedtls context for the rest of its life. mbedtls caches
+// blinding/precomputation state inside the context, which is why these are
+// per thread rather than shared.
+
+#define JWT_MAX_KEYS 32
+#define DER_MAX_SIZE 2048   // Enough for an 8192-bit RSA key
+
+typedef enum {
+    KEY_TYPE_RSA,
+    KEY_TYPE_EC,
+    KEY_TYPE_OKP   // Ed25519
+} JwtKeyType;
+
+typedef struct {
+    char kid[128];         // "" for the key from JwtPublicKey
+    JwtAlgorithm alg;      // JWKS "alg", or JWT_ALG_UNKNOWN if unrestricted
+    JwtKeyType type;
+    char* material;        // PEM (RSA/EC) or hex (Ed25519), NUL-terminated
+    size_t material_len;   // Without the NUL
+} JwtKey;
+
+static struct {
+    JwtKey keys[JWT_MAX_KEYS];
+    int count;
+    unsigned int generation;  // Bumped by jwt_keys_load, invalidates thread caches
+} K;
+
+// Per-thread parsed keys, parallel to K.keys
+typedef enum { PARSED_NONE = 0, PARSED_OK, PARSED_FAILED } ParsedState;
+static __thread mbedtls_pk_context tls_pk[JWT_MAX_KEYS];
+static __thread unsigned char tls_state[JWT_MAX_KEYS];
+static __thread unsigned int tls_generation;
+
+static const struct {
+    const char* name;
+    JwtAlgorithm alg;
+    int l8w8jwt_alg;
+} ALGORITHMS[] = {
+    { "HS256", JWT_ALG_HS256, L8W8JWT_ALG_HS256 },
+    { "HS384", JWT_ALG_HS384, L8W8JWT_ALG_HS384 },
+    { "HS512", JWT_ALG_HS512, L8W8JWT_ALG_HS512 },
+    { "RS256", JWT_ALG_RS256, L8W8JWT_ALG_RS256 },
+    { "RS384", JWT_ALG_RS384, L8W8JWT_ALG_RS384 },
+    { "RS512", JWT_ALG_RS512, L8W8JWT_ALG_RS512 },
+    { "PS256", JWT_ALG_PS256, L8W8JWT_ALG_PS256 },
+    { "PS384", JWT_ALG_PS384, L8W8JWT_ALG_PS384 },
+    { "PS512", JWT_ALG_PS512, L8W8JWT_ALG_PS512 },
+    { "ES256", JWT_ALG_ES256, L8W8JWT_ALG_ES256 },
+    { "ES384", JWT_ALG_ES384, L8W8JWT_ALG_ES384 },
+    { "ES512", JWT_ALG_ES512, L8W8JWT_ALG_ES512 },
+    { "EdDSA", JWT_ALG_EDDSA, L8W8JWT_ALG_ED25519 },
+};
+
+JwtAlgorithm jwt_alg_from_name(const char* name) {
+    if (!name) return JWT_ALG_UNKNOWN;
+    for (size_t i = 0; i < sizeof(ALGORITHMS) / sizeof(ALGORITHMS[0]); i++) {
+        if (strcmp(ALGORITHMS[i].name, name) == 0) {
+            return ALGORITHMS[i].alg;
+        }
+    }
+    return JWT_ALG_UNKNOWN;
+}
+
+bool jwt_alg_is_asymmetric(JwtAlgorithm alg) {
+    return alg >= JWT_ALG_RS256 && alg <= JWT_ALG_EDDSA;
+}
+
+int jwt_alg_to_l8w8jwt(JwtAlgorithm alg) {
+    for (size_t i = 0; i < sizeof(ALGORITHMS) / sizeof(ALGORITHMS[0]); i++) {
+        if (ALGORITHMS[i].alg == alg) {
+            return ALGORITHMS[i].l8w8jwt_alg;
+        }
+    }
+    return -1;
+}
+
+static JwtKeyType key_type_for(JwtAlgorithm alg) {
+    if (alg >= JWT_ALG_ES256 && alg <= JWT_ALG_ES512) return KEY_TYPE_EC;
+    if (alg == JWT_ALG_EDDSA) return KEY_TYPE_OKP;
+    return KEY_TYPE_RSA;
+}
+
+// ============================================================================
+// Encoding helpers (JWK -> DER -> PEM)
+// ============================================================================
+
+static int b64url_value(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '-') return 62;
+    if (c == '_') return 63;
+    return -1;
+}
+
+// Decodes a base64url JWK member. Returns the length, or -1.
+static long b64url_decode(const char* in, unsigned char* out, size_t out_size) {
+    size_t out_len = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (; *in && *in != '='; in++) {
+        int v = b64url_value((unsigned char)*in);
+        if (v < 0) return -1;
+        acc = (acc << 6) | (uint32_t)v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (out_len >= out_size) return -1;
+            out[out_len++] = (unsigned char)(acc >> bits);
+        }
+    }
+    return (long)out_len;
+}
+
+// Writes a DER length. Returns the number of bytes used.
+static size_t der_put_length(unsigned char* out, size_t len) {
+    if (len < 0x80) {
+        out[0] = (unsigned char)len;
+        return 1;
+    }
+    if (len <= 0xff) {
+        out[0] = 0x81;
+        out[1] = (unsigned char)len;
+        return 2;
+    }
+    out[0] = 0x82;
+    out[1] = (unsigned char)(len >> 8);
+    out[2] = (unsigned char)len;
+    return 3;
+}
+
+// Writes tag + length + content. Returns the total size, or 0 if it does not fit.
+static size_t der_put(unsigned char* out, size_t out_size, unsigned char tag,
+                      const unsigned char* content, size_t len) {
+    if (len > 0xffff || len + 4 > out_size) return 0;
+    out[0] = tag;
+    size_t header = 1 + der_put_length(out + 1, len);
+    memmove(out + header, content, len);
+    return header + len;
+}
+
+// Writes a big-endian unsigned integer as a DER INTEGER (minimal, non-negative).
+static size_t der_put_uint(unsigned char* out, size_t out_size, const unsigned char* bytes, size_t len) {
+    while (len > 1 && bytes[0] == 0) {
+        bytes++;
+        len--;
+    }
+    unsigned char tmp[DER_MAX_SIZE];
+    size_t n = 0;
+    if (len + 1 > sizeof(tmp)) return 0;
+    if (bytes[0] & 0x80) tmp[n++] = 0x00;
+    memcpy(tmp + n, bytes, len);
+    return der_put(out, out_size, 0x02, tmp, n + len);
+}
+
+static const unsigned char OID_RSA_ENCRYPTION[] = { 0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01, 0x01, 0x05, 0x00 };
+static const unsigned char OID_EC_PUBLIC_KEY[] = { 0x06, 0x07, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01 };
+static const unsigned char OID_P256[] = { 0x06, 0x08, 0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07 };
+static const unsigned char OID_P384[] = { 0x06, 0x05, 0x2b, 0x81, 0x04, 0x00, 0x22 };
+static const unsigned char OID_P521[] = { 0x06, 0x05, 0x2b, 0x81, 0x04, 0x00, 0x23 };
+
+// SubjectPublicKeyInfo { AlgorithmIdentifier, BIT STRING key }
+static size_t der_put_spki(unsigned char* out, size_t out_size,
+                           const unsigned char* alg_id, size_t alg_id_len,
+                           const unsigned char* key, size_t key_len) {
+    unsigned char alg_seq[64];
+    size_t alg_seq_len = der_put(alg_seq, sizeof(alg_seq), 0x30, alg_id, alg_id_len);
+
+    unsigned char bits[DER_MAX_SIZE];
+    if (key_len + 1 > sizeof(bits)) return 0;
+    bits[0] = 0x00; // No unused bits
+    memcpy(bits + 1, key, key_len);
+    unsigned char bit_string[DER_MAX_SIZE];
+    size_t bit_string_len = der_put(bit_string, sizeof(bit_string), 0x03, bits, key_len + 1);
+    if (!alg_seq_len || !bit_string_len || alg_seq_len + bit_string_len > sizeof(bits)) return 0;
+
+    memcpy(bits, alg_seq, alg_seq_len);
+    memcpy(bits + alg_seq_len, bit_string, bit_string_len);
+    return der_put(out, out_size, 0x30, bits, alg_seq_len + bit_string_len);
+}
+
+static size_t jwk_rsa_to_der(const char* n_b64, const char* e_b64, unsigned char* out, size_t out_size) {
+    unsigned char n[DER_MAX_SIZE / 2], e[16];
+    long n_len = b64url_decode(n_b64, n, sizeof(n));
+    long e_len = b64url_decode(e_b64, e, sizeof(e));
+    if (n_len <= 0 || e_len <= 0) return 0;
+
+    // RSAPublicKey ::= SEQUENCE { modulus INTEGER, publicExponent INTEGER }
+    unsigned char ints[DER_MAX_SIZE];
+    size_t n_der = der_put_uint(ints, sizeof(ints), n, n_len);
+    if (!n_der) return 0;
+    size_t e_der = der_put_uint(ints + n_der, sizeof(ints) - n_der, e, e_len);
+    if (!e_der) return 0;
+    unsigned char rsa_key[DER_MAX_SIZE];
+    size_t rsa_key_len = der_put(rsa_key, sizeof(rsa_key), 0x30, ints, n_der + e_der);
+    if (!rsa_key_len) return 0;
+
+    return der_put_spki(out, out_size, OID_RSA_ENCRYPTION, sizeof(OID_RSA_ENCRYPTION), rsa_key, rsa_key_len);
+}
+
+static size_t jwk_ec_to_der(const char* crv, const char* x_b64, const char* y_b64,
+                            unsigned char* out, size_t out_size) {
+    const unsigned char* curve_oid;
+    size_t curve_oid_len, coord_len;
+    if (strcmp(crv, "P-256") == 0) {
+        curve_oid = OID_P256; curve_oid_len = sizeof(OID_P256); coord_len = 32;
+    } else if (strcmp(crv, "P-384") == 0) {
+        curve_oid = OID_P384; curve_oid_len = sizeof(OID_P384); coord_len = 48;
+    } else if (strcmp(crv, "P-521") == 0) {
+        curve_oid = OID_P521; curve_oid_len = sizeof(OID_P521); coord_len = 66;
+    } else {
+        return 0;
+    }
+
+    // Uncompressed point: 0x04 || x || y
+    unsigned char point[1 + 2 * 66];
+    point[0] = 0x04;
+    if (b64url_decode(x_b64, point + 1, coord_len) != (long)coord_len ||
+        b64url_decode(y_b64, point + 1 + coord_len, coord_len) != (long)coord_len) {
+        return 0;
+    }
+
+    unsigned char alg_id[32];
+    memcpy(alg_id, OID_EC_PUBLIC_KEY, sizeof(OID_EC_PUBLIC_KEY));
+    memcpy(alg_id + sizeof(OID_EC_PUBLIC_KEY), curve_oid, curve_oid_len);
+    return der_put_spki(out, out_size, alg_id, sizeof(OID_EC_PUBLIC_KEY) + curve_oid_len,
+                        point, 1 + 2 * coord_len);
+}
+
+// Wraps DER in "-----BEGIN PUBLIC KEY-----" armor. Returns a malloc'd string.
+static char* der_to_pem(const unsigned char* der, size_t der_len) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t b64_len = (der_len + 2) / 3 * 4;
+    char* pem = malloc(b64_len + b64_len / 64 + 64);
+    if (!pem) return NULL;
+
+    char* p = pem + sprintf(pem, "-----BEGIN PUBLIC KEY-----\n");
+    size_t line = 0;
+    for (size_t i = 0; i < der_len; i += 3) {
+        uint32_t v = (uint32_t)der[i] << 16;
+        if (i + 1 < der_len) v |= (uint32_t)der[i + 1] << 8;
+        if (i + 2 < der_len) v |= der[i + 2];
+        *p++ = alphabet[(v >> 18) & 63];
+        *p++ = alphabet[(v >> 12) & 63];
+        *p++ = i + 1 < der_len ? alphabet[(v >> 6) & 63] : '=';
+        *p++ = i + 2 < der_len ? alphabet[v & 63] : '=';
+        if ((line += 4) == 64) {
+            *p++ = '\n';
+            line = 0;
+        }
+    }
+    if (line) *p++ = '\n';
+    strcpy(p, "-----END PUBLIC KEY-----\n");
+    return pem;
+}
+
+// ============================================================================
+// Loading
+// ============================================================================
+
+static void keys_clear() {
+    for (int i = 0; i < K.count; i++) {
+        free(K.keys[i].material);
+    }
+    memset(K.keys, 0, sizeof(K.keys));
+    K.count = 0;
+    K.generation++;
+}
+
+static JwtKey* key_add(const char* kid, JwtAlgorithm alg, JwtKeyType type, char* material) {
+    if (!material) return NULL;
+    if (K.count >= JWT_MAX_KEYS) {
+        log_system(LOG_WARNING, "JwtKeys: More than %d keys, ignoring '%s'.", JWT_MAX_KEYS, kid);
+        free(material);
+        return NULL;
+    }
+    JwtKey* key = &K.keys[K.count++];
+    snprintf(key->kid, sizeof(key->kid), "%s", kid ? kid : "");
+    key->alg = alg;
+    key->type = type;
+    key->material = material;
+    key->material_len = strlen(material);
+    return key;
+}
+
+static char* read_text_file(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return NULL;
+    char* data = NULL;
+    if (fseek(fp, 0, SEEK_END) == 0) {
+        long size = ftell(fp);
+        if (size >= 0 && fseek(fp, 0, SEEK_SET) == 0 && (data = malloc(size + 1))) {
+            size_t n = fread(data, 1, size, fp);
+            data[n] = '\0';
+        }
+    }
+    fclose(fp);
+    return data;
+}
+
+static int load_jwks(const char* path) {
+    yyjson_read_err err;
+    yyjson_doc* doc = yyjson_read_file(path, 0, NULL, &err);
+    if (!doc) {
+        log_system(LOG_ERROR, "JwtKeys: Cannot parse JWKS '%s': %s at %zu", path, err.msg, err.pos);
+        return -1;
+    }
+
+    int loaded = 0;
+    yyjson_val* keys = yyjson_obj_get(yyjson_doc_get_root(doc), "keys");
+    size_t idx, max;
+    yyjson_val* jwk;
+    yyjson_arr_foreach(keys, idx, max, jwk) {
+        const char* kty = yyjson_get_str(yyjson_obj_get(jwk, "kty"));
+        const char* kid = yyjson_get_str(yyjson_obj_get(jwk, "kid"));
+        const char* use = yyjson_get_str(yyjson_obj_get(jwk, "use"));
+        const char* alg_name = yyjson_get_str(yyjson_obj_get(jwk, "alg"));
+        if (!kty || (use && strcmp(use, "sig") != 0)) {
+            continue;
+        }
+        JwtAlgorithm alg = alg_name ? jwt_alg_from_name(alg_name) : JWT_ALG_UNKNOWN;
+        if (alg_name && !jwt_alg_is_asymmetric(alg)) {
+            log_system(LOG_WARNING, "JwtKeys: Skipping key '%s' with unsupported alg '%s'.", kid ? kid : "", alg_name);
+            continue;
+        }
+
+        unsigned char der[DER_MAX_SIZE];
+        size_t der_len = 0;
+        JwtKey* key = NULL;
+        if (strcmp(kty, "RSA") == 0) {
+            const char* n = yyjson_get_str(yyjson_obj_get(jwk, "n"));
+            const char* e = yyjson_get_str(yyjson_obj_get(jwk, "e"));
+            if (n && e) der_len = jwk_rsa_to_der(n, e, der, sizeof(der));
+            if (der_len) key = key_add(kid, alg, KEY_TYPE_RSA, der_to_pem(der, der_len));
+        } else if (strcmp(kty, "EC") == 0) {
+            const char* crv = yyjson_get_str(yyjson_obj_get(jwk, "crv"));
+            const char* x = yyjson_get_str(yyjson_obj_get(jwk, "x"));
+            const char* y = yyjson_get_str(yyjson_obj_get(jwk, "y"));
+            if (crv && x && y) der_len = jwk_ec_to_der(crv, x, y, der, sizeof(der));
+            if (der_len) key = key_add(kid, alg, KEY_TYPE_EC, der_to_pem(der, der_len));
+        } else if (strcmp(kty, "OKP") == 0) {
+            const char* crv = yyjson_get_str(yyjson_obj_get(jwk, "crv"));
+            const char* x = yyjson_get_str(yyjson_obj_get(jwk, "x"));
+            unsigned char raw[32];
+            if (crv && x && strcmp(crv, "Ed25519") == 0 && b64url_decode(x, raw, sizeof(raw)) == 32) {
+                char* hex = malloc(65);
+                if (hex) {
+                    for (int i = 0; i < 32; i++) sprintf(hex + i * 2, "%02x", raw[i]);
+                }
+                key = key_add(kid, alg, KEY_TYPE_OKP, hex);
+            }
+        }
+
+        if (key) {
+            loaded++;
+        } else {
+            log_system(LOG_WARNING, "JwtKeys: Skipping unusable %s key '%s' in '%s'.", kty, kid ? kid : "", path);
+        }
+    }
+    yyjson_doc_free(doc);
+    return loaded;
+}
+
+int jwt_keys_load(const ServerConfig* config) {
+    keys_clear();
+    JwtAlgorithm alg = jwt_alg_from_name(config->jwt_algorithm);
+
+    if (config->jwt_public_key[0] != '\0') {
+        char* pem = read_text_file(config->jwt_public_key);
+        if (!pem) {
+            log_system(LOG_ERROR, "JwtKeys: Cannot read public key '%s'.", config->jwt_public_key);
+            return -1;
+        }
+        key_add("", JWT_ALG_UNKNOWN, key_type_for(alg), pem);
+    }
+    if (config->jwt_jwks_file[0] != '\0' && load_jwks(config->jwt_jwks_file) < 0) {
+        return -1;
+    }
+
+    log_system(LOG_INFO, "JwtKeys: Loaded %d public key(s) for %s.", K.count, config->jwt_algorithm);
+    return K.count;
+}
+
+// ============================================================================
+// Verification
+// ============================================================================
+
+// The token's kid selects the key; without one, the first key usable for alg.
+// A kid unknown to the JWKS still matches the JwtPublicKey key (which has none).
+static int key_index_for(JwtAlgorithm alg, const char* kid) {
+    JwtKeyType type = key_type_for(alg);
+    int unnamed = -1;
+    for (int i = 0; i < K.count; i++) {
+        const JwtKey* key = &K.keys[i];
+        if (key->type != type || (key->alg != JWT_ALG_UNKNOWN && key->alg != alg)) {
+            continue;
+        }
+        if (!kid || strcmp(key->kid, kid) == 0) {
+            return i;
+        }
+        if (key->kid[0] == '\0' && unnamed < 0) {
+            unnamed = i;
+        }
+    }
+    return unnamed;
+}
+
+static mbedtls_pk_context* thread_key(int index) {
+    if (tls_generation != K.generation) {
+        for (int i = 0; i < JWT_MAX_KEYS; i++) {
+            if (tls_state[i] == PARSED_OK) mbedtls_pk_free(&tls_pk[i]);
+            tls_state[i] = PARSED_NONE;
+        }
+        tls_generation = K.generation;
+    }
+
+    if (tls_state[index] == PARSED_NONE) {
+        const JwtKey* key = &K.keys[index];
+        mbedtls_pk_init(&tls_pk[index]);
+        // The PEM parser wants the terminating NUL included in the length
+        if (mbedtls_pk_parse_public_key(&tls_pk[index], (const unsigned char*)key->material,
+                                        key->material_len + 1) == 0) {
+            tls_state[index] = PARSED_OK;
+        } else {
+            mbedtls_pk_free(&tls_pk[index]);
+            tls_state[index] = PARSED_FAILED;
+            log_system_rl(LOG_ERROR, "JwtKeys: Cannot parse public key '%s'.", key->kid);
+        }
+    }
+    return tls_state[index] == PARSED_OK ? &tls_pk[index] : NULL;
+}
+
+// JWS carries ECDSA signatures as raw r||s; mbedtls expects DER.
+static size_t ecdsa_raw_to_der(const unsigned char* sig, size_t sig_len, unsigned char* out, size_t out_size) {
+    size_t half = sig_len / 2;
+    unsigned char ints[2 * (66 + 4)];
+    size_t r_len = der_put_uint(ints, sizeof(ints), sig, half);
+    if (!r_len) return 0;
+    size_t s_len = der_put_uint(ints + r_len, sizeof(ints) - r_len, sig + half, half);
+    if (!s_len) return 0;
+    return der_put(out, out_size, 0x30, ints, r_len + s_len);
+}
+
+int jwt_keys_verify(JwtAlgorithm alg, const char* kid,
+                    const unsigned char* signing_input, size_t input_len,
+                    const unsigned char* sig, size_t sig_len) {
+    mbedtls_md_type_t md_type;
+    size_t ec_bits = 0;
+    switch (alg) {
+        case JWT_ALG_RS256: md_type = MBEDTLS_MD_SHA256; break;
+        case JWT_ALG_RS384: md_type = MBEDTLS_MD_SHA384; break;
+        case JWT_ALG_RS512: md_type = MBEDTLS_MD_SHA512; break;
+        case JWT_ALG_ES256: md_type = MBEDTLS_MD_SHA256; ec_bits = 256; break;
+        case JWT_ALG_ES384: md_type = MBEDTLS_MD_SHA384; ec_bits = 384; break;
+        case JWT_ALG_ES512: md_type = MBEDTLS_MD_SHA512; ec_bits = 521; break;
+        default: return -1; // PS* needs per-key padding setup, EdDSA is not in mbedtls
+    }
+
+    int index = key_index_for(alg, kid);
+    if (index < 0) {
+        log_system_rl(LOG_INFO, "JwtKeys: No key for kid '%s'.", kid ? kid : "(none)");
+        return 0;
+    }
+    mbedtls_pk_context* pk = thread_key(index);
+    if (!pk) return 0;
+
+    const mbedtls_md_info_t* md_info = mbedtls_md_info_from_type(md_type);
+    unsigned char hash[64];
+    if (!md_info || mbedtls_md(md_info, signing_input, input_len, hash) != 0) {
+        return 0;
+    }
+    size_t hash_len = mbedtls_md_get_size(md_info);
+
+    if (ec_bits) {
+        // The curve must match the algorithm (ES256 = P-256, ...)
+        size_t coord_len = (ec_bits + 7) / 8;
+        if (!mbedtls_pk_can_do(pk, MBEDTLS_PK_ECDSA) || mbedtls_pk_get_bitlen(pk) != ec_bits ||
+            sig_len != 2 * coord_len) {
+            return 0;
+        }
+        unsigned char der_sig[2 * (66 + 4) + 4];
+        size_t der_len = ecdsa_raw_to_der(sig, sig_len, der_sig, sizeof(der_sig));
+        return der_len && mbedtls_pk_verify(pk, md_type, hash, hash_len, der_sig, der_len) == 0;
+    }
+
+    if (!mbedtls_pk_can_do(pk, MBEDTLS_PK_RSA)) {
+        return 0;
+    }
+    return mbedtls_pk_verify(pk, md_type, hash, hash_len, sig, sig_len) == 0;
+}
+
+const unsigned char* jwt_keys_l8w8jwt_key(JwtAlgorithm alg, const char* kid, size_t* len_out) {
+    int index = key_index_for(alg, kid);
+    if (index < 0) {
+        return NULL;
+    }
+    *len_out = K.keys[index].material_len;
+    return (const unsigned char*)K.keys[index].material;
+}
@@ -5,6 +5,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h> // For bool type
+#include <sys/stat.h> // For fstat
+#include <errno.h>
+#include <pthread.h>
 
 // --- Pre-initialization Buffer ---
 typedef struct {
@@ -25,8 +28,25 @@ static struct {
     FILE* system_log_fp;
     FILE* access_log_fp;
     bool is_initialized;
+
+    // Rotation (see logger_set_rotation)
+    char log_path[256];
+    size_t system_log_bytes;          // Current size of system.log
+    size_t access_log_bytes;          // Current size of access.log
+    size_t rotate_max_bytes;          // 0 = no size-based rotation
+    bool rotate_daily;
+    time_t next_daily_rotation;
+
+    // Load shedding (see logger_set_limits)
+    unsigned int rate_limit;          // Messages per second per call site, 0 = unlimited
+    unsigned int access_sample_rate;  // Log 1 in N successful requests, 0/1 = log all
+    unsigned long access_counter;
+    LogRateLimit access_error_rl;     // Shared bucket for 4xx access lines
 } L;
 
+// Serializes output and logger state: worker threads (see worker_pool.h) log too
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static const char* level_strings[] = {
     "DEBUG", "INFO", "WARNING", "ERROR"
 };
@@ -50,7 +70,8 @@ static void flush_and_free_buffer() {
              struct tm* tm_info = localtime(&log_buffer[i].timestamp);
              char time_buf[26];
              strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", tm_info);
-             fprintf(out, "[%s] [%s] %s\n", time_buf, level_strings[log_buffer[i].level], log_buffer[i].message);
+             int n = fprintf(out, "[%s] [%s] %s\n", time_buf, level_strings[log_buffer[i].level], log_buffer[i].message);
+             if (n > 0 && out == L.system_log_fp) L.system_log_bytes += n;
              fflush(out);
         }
         
@@ -66,6 +87,19 @@ static void flush_and_free_buffer() {
 }
 
 
+// Opens <log_path>/<name> for appending and reports its current size.
+static FILE* open_log_file(const char* name, size_t* size_out) {
+    char path_buf[512];
+    snprintf(path_buf, sizeof(path_buf), "%s/%s", L.log_path, name);
+    FILE* fp = fopen(path_buf, "a");
+    if (!fp) {
+        return NULL;
+    }
+    struct stat st;
+    *size_out = (fstat(fileno(fp), &st) == 0) ? (size_t)st.st_size : 0;
+    return fp;
+}
+
 int logger_init(LogLevel level, LogTarget target, const char* log_path) {
     // If logger was already initialized, shut it down first to reconfigure
     if (L.is_initialized) {
@@ -77,22 +111,20 @@ int logger_init(LogLevel level, LogTarget target, const char* log_path) {
     L.system_log_fp = NULL;
     L.access_log_fp = NULL;
     L.is_initialized = false; // Set to false until setup is complete
+    snprintf(L.log_path, sizeof(L.log_path), "%s", log_path ? log_path : ".");
 
     if (L.target == LOG_TARGET_FILE) {
-        char path_buf[256];
-        
-        snprintf(path_buf, sizeof(path_buf), "%s/system.log", log_path);
-        L.system_log_fp = fopen(path_buf, "a");
+        L.system_log_fp = open_log_file("system.log", &L.system_log_bytes);
         if (!L.system_log_fp) {
             perror("fopen system.log");
             return -1;
         }
 
-        snprintf(path_buf, sizeof(path_buf), "%s/access.log", log_path);
-        L.access_log_fp = fopen(path_buf, "a");
+        L.access_log_fp = open_log_file("access.log", &L.access_log_bytes);
         if (!L.access_log_fp) {
             perror("fopen access.log");
             fclose(L.system_log_fp);
+            L.system_log_fp = NULL;
             return -1;
         }
     }
@@ -123,7 +155,7 @@ void logger_shutdown() {
     L.is_initialized = false;
 }
 
-void log_system(LogLevel level, const char* format, ...) {
+static void vlog_system_unlocked(LogLevel level, const char* format, va_list args) {
     // If the logger is not yet initialized, buffer the message.
     if (!L.is_initialized) {
         if (buffer_count >= buffer_capacity) {
@@ -137,15 +169,11 @@ void log_system(LogLevel level, const char* format, ...) {
             buffer_capacity = new_capacity;
         }
 
-        va_list args;
-        va_start(args, format);
         char* message;
         // vasprintf is a GNU extension that allocates the string for us.
         if (vasprintf(&message, format, args) == -1) {
-            va_end(args);
             return; // Allocation failed
         }
-        va_end(args);
 
         log_buffer[buffer_count].level = level;
         log_buffer[buffer_count].message = message;
@@ -169,20 +197,100 @@ void log_system(LogLevel level, const char* format, ...) {
     strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", tm_info);
 
     // Print log prefix
-    fprintf(out, "[%s] [%s] ", time_buf, level_strings[level]);
+    int n = fprintf(out, "[%s] [%s] ", time_buf, level_strings[level]);
 
     // Print user message
+    n += vfprintf(out, format, args);
+
+    // Print newline
+    n += fprintf(out, "\n");
+    fflush(out);
+    if (out == L.system_log_fp && n > 0) {
+        L.system_log_bytes += n;
+    }
+}
+
+static void vlog_system(LogLevel level, const char* format, va_list args) {
+    pthread_mutex_lock(&log_lock);
+    vlog_system_unlocked(level, format, args);
+    pthread_mutex_unlock(&log_lock);
+}
+
+void log_system(LogLevel level, const char* format, ...) {
     va_list args;
     va_start(args, format);
-    vfprintf(out, format, args);
+    vlog_system(level, format, args);
     va_end(args);
+}
 
-    // Print newline
-    fprintf(out, "\n");
-    fflush(out);
+// --- Rate Limiting ---
+
+static long monotonic_seconds() {
+    struct timespec ts;
+    // The coarse clock is served from the vDSO and is plenty for 1s granularity
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (long)ts.tv_sec;
 }
 
-void log_access(const char* remote_addr, const char* method, const char* uri, int status_code) {
+/**
+ * Per-call-site token bucket, refilled to L.rate_limit tokens at each new second.
+ * Returns true if the caller may emit a line. When a line is allowed after a
+ * suppressed burst, *suppressed receives the number of dropped lines (and is reset).
+ */
+static bool ratelimit_take(LogRateLimit* rl, unsigned long* suppressed) {
+    *suppressed = 0;
+    if (L.rate_limit == 0) {
+        return true;
+    }
+
+    long now = monotonic_seconds();
+    if (!rl->primed || now != rl->last_refill) {
+        rl->tokens = L.rate_limit;
+        rl->last_refill = now;
+        rl->primed = true;
+    }
+
+    if (rl->tokens == 0) {
+        rl->suppressed++;
+        return false;
+    }
+    rl->tokens--;
+    *suppressed = rl->suppressed;
+    rl->suppressed = 0;
+    return true;
+}
+
+void log_system_ratelimited(LogRateLimit* rl, LogLevel level, const char* format, ...) {
+    // Cheap level check first, so filtered messages don't consume tokens
+    if (L.is_initialized && level < L.level) {
+        return;
+    }
+
+    unsigned long suppressed;
+    pthread_mutex_lock(&log_lock);
+    bool allowed = ratelimit_take(rl, &suppressed);
+    pthread_mutex_unlock(&log_lock);
+    if (!allowed) {
+        return;
+    }
+    if (suppressed > 0) {
+        log_system(level, "Logger: Suppressed %lu similar messages.", suppressed);
+    }
+
+    va_list args;
+    va_start(args, format);
+    vlog_system(level, format, args);
+    va_end(args);
+}
+
+void logger_set_limits(unsigned int rate_limit, unsigned int access_sample_rate) {
+    L.rate_limit = rate_limit;
+    L.access_sample_rate = access_sample_rate;
+    L.access_counter = 0;
+    memset(&L.access_error_rl, 0, sizeof(L.access_error_rl));
+}
+
+static void log_access_unlocked(const char* remote_addr, const char* method, const char* uri, int status_code) {
     // Access logs are not buffered as they are tied to live requests
     // which only happen after the server is fully started.
     if (!L.is_initialized) return;
@@ -190,6 +298,21 @@ void log_access(const char* remote_addr, const char* method, const char* uri, in
     FILE* out = (L.target == LOG_TARGET_STDOUT) ? stdout : L.access_log_fp;
     if (!out) return;
 
+    // Sampling: 5xx are always logged, 4xx share a token bucket (scanners and
+    // floods are mostly 4xx), everything else is logged 1 in N.
+    unsigned long suppressed = 0;
+    if (status_code >= 500) {
+        // Always log server errors
+    } else if (status_code >= 400) {
+        if (!ratelimit_take(&L.access_error_rl, &suppressed)) {
+            return;
+        }
+    } else if (L.access_sample_rate > 1) {
+        if (L.access_counter++ % L.access_sample_rate != 0) {
+            return;
+        }
+    }
+
     // Get current time
     time_t timer = time(NULL);
     struct tm* tm_info = localtime(&timer);
@@ -198,6 +321,146 @@ void log_access(const char* remote_addr, const char* method, const char* uri, in
 
     // Format: [Time] IP "METHOD URI HTTP/1.1" STATUS
     // We assume HTTP/1.1 for now.
-    fprintf(out, "[%s] %s \"%s %s HTTP/1.1\" %d\n", time_buf, remote_addr ? remote_addr : "-", method, uri, status_code);
+    int n = 0;
+    if (suppressed > 0) {
+        n += fprintf(out, "[%s] - suppressed %lu client error lines\n", time_buf, suppressed);
+    }
+    n += fprintf(out, "[%s] %s \"%s %s HTTP/1.1\" %d\n", time_buf, remote_addr ? remote_addr : "-", method, uri, status_code);
     fflush(out);
-} 
\ No newline at end of file
+    if (out == L.access_log_fp && n > 0) {
+        L.access_log_bytes += n;
+    }
+}
+
+void log_access(const char* remote_addr, const char* method, const char* uri, int status_code) {
+    pthread_mutex_lock(&log_lock);
+    log_access_unlocked(remote_addr, method, uri, status_code);
+    pthread_mutex_unlock(&log_lock);
+}
+
+// --- Rotation & Reopen ---
+
+// Local midnight following `now`, the boundary for daily rotation.
+static time_t next_midnight(time_t now) {
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+    tm_info.tm_hour = 0;
+    tm_info.tm_min = 0;
+    tm_info.tm_sec = 0;
+    tm_info.tm_mday += 1;
+    tm_info.tm_isdst = -1;
+    return mktime(&tm_info);
+}
+
+void logger_set_rotation(size_t max_bytes, bool daily) {
+    L.rotate_max_bytes = max_bytes;
+    L.rotate_daily = daily;
+    L.next_daily_rotation = daily ? next_midnight(time(NULL)) : 0;
+}
+
+// Opens <name> afresh in place of *fp. The old stream is closed only once its
+// replacement exists, so a failed open (e.g. EMFILE) does not stop logging.
+static int reopen_file(FILE** fp, const char* name, size_t* bytes) {
+    size_t new_bytes = 0;
+    FILE* new_fp = open_log_file(name, &new_bytes);
+    if (!new_fp) {
+        return -1;
+    }
+    if (*fp) {
+        fclose(*fp);
+    }
+    *fp = new_fp;
+    *bytes = new_bytes;
+    return 0;
+}
+
+// Renames <name> to <name>.<suffix>[.N] and starts a fresh file in its place.
+static void rotate_file(FILE** fp, const char* name, size_t* bytes, const char* suffix) {
+    char path_buf[512];
+    char rotated_buf[600];
+    snprintf(path_buf, sizeof(path_buf), "%s/%s", L.log_path, name);
+    snprintf(rotated_buf, sizeof(rotated_buf), "%s.%s", path_buf, suffix);
+
+    // The suffix has second resolution; never overwrite an earlier archive
+    struct stat st;
+    for (int seq = 1; stat(rotated_buf, &st) == 0 && seq < 1000; seq++) {
+        snprintf(rotated_buf, sizeof(rotated_buf), "%s.%s.%d", path_buf, suffix, seq);
+    }
+
+    if (*fp) {
+        fflush(*fp);
+    }
+    // ENOENT: an earlier rotation renamed it but could not open the new file
+    if (rename(path_buf, rotated_buf) != 0 && errno != ENOENT) {
+        perror("rename log file");
+        *bytes = 0; // Keep writing where we are; retried after another rotate_max_bytes
+        return;
+    }
+    if (reopen_file(fp, name, bytes) != 0) {
+        perror("fopen rotated log file");
+        *bytes = 0;
+    }
+}
+
+int logger_reopen() {
+    if (!L.is_initialized || L.target != LOG_TARGET_FILE) {
+        return 0;
+    }
+
+    int result = 0;
+    pthread_mutex_lock(&log_lock);
+    if (reopen_file(&L.system_log_fp, "system.log", &L.system_log_bytes) != 0) {
+        perror("fopen system.log");
+        result = -1;
+    }
+    if (reopen_file(&L.access_log_fp, "access.log", &L.access_log_bytes) != 0) {
+        perror("fopen access.log");
+        result = -1;
+    }
+    pthread_mutex_unlock(&log_lock);
+
+    if (result == 0) {
+        log_system(LOG_INFO, "Logger: Reopened log files in '%s'.", L.log_path);
+    } else {
+        log_system(LOG_ERROR, "Logger: Could not reopen log files in '%s', still writing to the old ones.", L.log_path);
+    }
+    return result;
+}
+
+void logger_rotate_if_needed() {
+    if (!L.is_initialized || L.target != LOG_TARGET_FILE) {
+        return;
+    }
+
+    bool size_exceeded_sys = L.rotate_max_bytes > 0 && L.system_log_bytes >= L.rotate_max_bytes;
+    bool size_exceeded_acc = L.rotate_max_bytes > 0 && L.access_log_bytes >= L.rotate_max_bytes;
+    bool day_changed = false;
+    time_t now = 0;
+    if (L.rotate_daily) {
+        now = time(NULL);
+        day_changed = now >= L.next_daily_rotation;
+    }
+    if (!size_exceeded_sys && !size_exceeded_acc && !day_changed) {
+        return;
+    }
+
+    if (now == 0) now = time(NULL);
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+    char suffix[32];
+    strftime(suffix, sizeof(suffix), "%Y%m%d-%H%M%S", &tm_info);
+
+    pthread_mutex_lock(&log_lock);
+    if (size_exceeded_sys || day_changed) {
+        rotate_file(&L.system_log_fp, "system.log", &L.system_log_bytes, suffix);
+    }
+    if (size_exceeded_acc || day_changed) {
+        rotate_file(&L.access_log_fp, "access.log", &L.access_log_bytes, suffix);
+    }
+    if (day_changed) {
+        L.next_daily_rotation = next_midnight(now);
+    }
+    pthread_mutex_unlock(&log_lock);
+
+    log_system(LOG_INFO, "Logger: Rotated log files (suffix %s).", suffix);
+}
@@ -0,0 +1,211 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mime.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_EXT_LEN 15 // Longer extensions are never looked up
+#define MIME_TYPE_MAX 127
+
+typedef struct {
+    char ext[MAX_EXT_LEN + 1]; // Lowercase, "" = empty slot
+    uint32_t hash;
+    const MimeType* mime;
+} MimeSlot;
+
+static struct {
+    MimeSlot* slots;
+    size_t capacity;           // Power of two
+    size_t count;
+    MimeType** types;          // Owned, one per distinct type
+    size_t type_count;
+} M;
+
+static const MimeType default_type = {
+    "application/octet-stream",
+    "Content-Type: application/octet-stream\r\n",
+    sizeof("Content-Type: application/octet-stream\r\n") - 1,
+};
+
+// Used when no MimeTypesFile is configured, and as its base otherwise
+static const char* BUILTIN_TYPES[] = {
+    "text/html html htm",
+    "text/css css",
+    "text/plain txt",
+    "text/csv csv",
+    "text/xml xml",
+    "text/markdown md",
+    "application/javascript js mjs",
+    "application/json json map",
+    "application/manifest+json webmanifest",
+    "application/wasm wasm",
+    "application/pdf pdf",
+    "application/zip zip",
+    "application/gzip gz",
+    "image/jpeg jpg jpeg",
+    "image/png png",
+    "image/gif gif",
+    "image/webp webp",
+    "image/avif avif",
+    "image/svg+xml svg svgz",
+    "image/x-icon ico",
+    "font/woff woff",
+    "font/woff2 woff2",
+    "font/ttf ttf",
+    "font/otf otf",
+    "audio/mpeg mp3",
+    "audio/ogg ogg oga",
+    "audio/wav wav",
+    "video/mp4 mp4 m4v",
+    "video/webm webm",
+    "video/ogg ogv",
+};
+
+static uint32_t ext_hash(const char* ext) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (; *ext; ext++) {
+        h ^= (unsigned char)*ext;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static MimeSlot* find_slot(MimeSlot* slots, size_t capacity, const char* ext, uint32_t hash) {
+    size_t i = hash & (capacity - 1);
+    while (slots[i].ext[0] && (slots[i].hash != hash || strcmp(slots[i].ext, ext) != 0)) {
+        i = (i + 1) & (capacity - 1);
+    }
+    return &slots[i];
+}
+
+// Keeps the load factor at or below 1/2
+static bool grow(void) {
+    size_t capacity = M.capacity ? M.capacity * 2 : 128;
+    MimeSlot* slots = calloc(capacity, sizeof(MimeSlot));
+    if (!slots) return false;
+    for (size_t i = 0; i < M.capacity; i++) {
+        if (M.slots[i].ext[0]) {
+            *find_slot(slots, capacity, M.slots[i].ext, M.slots[i].hash) = M.slots[i];
+        }
+    }
+    free(M.slots);
+    M.slots = slots;
+    M.capacity = capacity;
+    return true;
+}
+
+static const MimeType* intern_type(const char* type) {
+    for (size_t i = 0; i < M.type_count; i++) {
+        if (strcmp(M.types[i]->type, type) == 0) return M.types[i];
+    }
+    MimeType** types = realloc(M.types, (M.type_count + 1) * sizeof(MimeType*));
+    if (!types) return NULL;
+    M.types = types;
+
+    // One block: the struct, the type, then the header line
+    size_t len = strlen(type);
+    size_t header_len = sizeof("Content-Type: \r\n") - 1 + len;
+    MimeType* mime = malloc(sizeof(MimeType) + len + 1 + header_len + 1);
+    if (!mime) return NULL;
+    char* text = (char*)(mime + 1);
+    memcpy(text, type, len + 1);
+    snprintf(text + len + 1, header_len + 1, "Content-Type: %s\r\n", type);
+    mime->type = text;
+    mime->header = text + len + 1;
+    mime->header_len = header_len;
+    M.types[M.type_count++] = mime;
+    return mime;
+}
+
+static void lowercase(char* dst, const char* src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        char c = src[i];
+        dst[i] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+    dst[len] = '\0';
+}
+
+// Adds "type ext1 ext2 ..." (a mime.types line without its comment)
+static void add_line(char* line) {
+    const char* delims = " \t\r\n";
+    char* save = NULL;
+    char* type = strtok_r(line, delims, &save);
+    if (!type || strlen(type) > MIME_TYPE_MAX || !strchr(type, '/')) return;
+
+    const MimeType* mime = NULL;
+    char* ext;
+    while ((ext = strtok_r(NULL, delims, &save))) {
+        size_t len = strlen(ext);
+        if (len > MAX_EXT_LEN) continue;
+        if (!mime && !(mime = intern_type(type))) return;
+        if ((M.count + 1) * 2 > M.capacity && !grow()) return;
+
+        char key[MAX_EXT_LEN + 1];
+        lowercase(key, ext, len);
+        uint32_t hash = ext_hash(key);
+        MimeSlot* slot = find_slot(M.slots, M.capacity, key, hash);
+        if (!slot->ext[0]) {
+            memcpy(slot->ext, key, len + 1);
+            slot->hash = hash;
+            M.count++;
+        }
+        slot->mime = mime; // Later entries win
+    }
+}
+
+static void clear(void) {
+    for (size_t i = 0; i < M.type_count; i++) {
+        free(M.types[i]);
+    }
+    free(M.types);
+    free(M.slots);
+    memset(&M, 0, sizeof(M));
+}
+
+int mime_init(const ServerConfig* config) {
+    clear();
+    char line[512];
+    for (size_t i = 0; i < sizeof(BUILTIN_TYPES) / sizeof(BUILTIN_TYPES[0]); i++) {
+        snprintf(line, sizeof(line), "%s", BUILTIN_TYPES[i]);
+        add_line(line);
+    }
+
+    if (!config || config->mime_types_file[0] == '\0') {
+        log_system(LOG_DEBUG, "MIME: %zu built-in extensions.", M.count);
+        return 0;
+    }
+    FILE* fp = fopen(config->mime_types_file, "r");
+    if (!fp) {
+        log_system(LOG_WARNING, "MIME: Could not open '%s', using the built-in types only.", config->mime_types_file);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        add_line(line);
+    }
+    fclose(fp);
+    log_system(LOG_INFO, "MIME: Loaded '%s', %zu extensions / %zu types.", config->mime_types_file, M.count, M.type_count);
+    return 0;
+}
+
+const MimeType* mime_lookup(const char* path) {
+    if (!path || M.count == 0) return &default_type;
+    const char* slash = strrchr(path, '/');
+    const char* dot = strrchr(slash ? slash : path, '.');
+    if (!dot || dot[1] == '\0') return &default_type;
+
+    size_t len = strlen(dot + 1);
+    if (len > MAX_EXT_LEN) return &default_type;
+    char key[MAX_EXT_LEN + 1];
+    lowercase(key, dot + 1, len);
+    const MimeSlot* slot = find_slot(M.slots, M.capacity, key, ext_hash(key));
+    return slot->ext[0] ? slot->mime : &default_type;
+}
+
+const MimeType* mime_default(void) {
+    return &default_type;
+}
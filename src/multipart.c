@@ -0,0 +1,351 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // For memmem, copy_file_range
+#endif
+#include "multipart.h"
+#include "logger.h"
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+
+// Copies a header value into a fixed buffer, truncating
+static void copy_value(char* dst, size_t size, const char* src, size_t len) {
+    if (len >= size) len = size - 1;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+int multipart_parser_init(MultipartParser* parser, const char* content_type) {
+    memset(parser, 0, sizeof(*parser));
+    if (!content_type || strncasecmp(content_type, "multipart/form-data", 19) != 0) {
+        return -1;
+    }
+
+    // boundary=value or boundary="value", among other parameters
+    const char* p = content_type + 19;
+    const char* boundary = NULL;
+    size_t blen = 0;
+    while ((p = strchr(p, ';')) != NULL) {
+        p++;
+        while (*p == ' ' || *p == '\t') p++;
+        if (strncasecmp(p, "boundary=", 9) != 0) continue;
+        p += 9;
+        if (*p == '"') {
+            boundary = ++p;
+            const char* end = strchr(p, '"');
+            if (!end) return -1;
+            blen = end - p;
+        } else {
+            boundary = p;
+            blen = strcspn(p, "; \t");
+        }
+        break;
+    }
+    if (!boundary || blen == 0 || blen > MULTIPART_BOUNDARY_MAX) {
+        return -1;
+    }
+
+    memcpy(parser->delim, "\r\n--", 4);
+    memcpy(parser->delim + 4, boundary, blen);
+    parser->delim_len = blen + 4;
+
+    // Horspool: how far the window may move when its last byte is c
+    memset(parser->skip, (int)parser->delim_len, sizeof(parser->skip));
+    for (size_t i = 0; i + 1 < parser->delim_len; i++) {
+        parser->skip[(unsigned char)parser->delim[i]] = (unsigned char)(parser->delim_len - 1 - i);
+    }
+    parser->state = MULTIPART_START;
+    return 0;
+}
+
+// Offset of the delimiter in hay, or -1
+static long find_delim(const MultipartParser* parser, const char* hay, size_t n) {
+    size_t m = parser->delim_len;
+    if (n < m) return -1;
+    const unsigned char last = (unsigned char)parser->delim[m - 1];
+    size_t i = 0;
+    while (i <= n - m) {
+        unsigned char c = (unsigned char)hay[i + m - 1];
+        if (c == last && memcmp(hay + i, parser->delim, m - 1) == 0) {
+            return (long)i;
+        }
+        i += parser->skip[c];
+    }
+    return -1;
+}
+
+// How much of hay (which holds no complete delimiter) is certainly not part of
+// one: everything before a tail that could still grow into the delimiter
+static size_t safe_prefix(const MultipartParser* parser, const char* hay, size_t n) {
+    size_t k = n >= parser->delim_len ? n - parser->delim_len + 1 : 0;
+    for (; k < n; k++) {
+        if (hay[k] == '\r' && memcmp(hay + k, parser->delim, n - k) == 0) {
+            return k;
+        }
+    }
+    return n;
+}
+
+// Content-Disposition: form-data; name="field"; filename="file.txt"
+static void parse_disposition(MultipartPart* part, const char* v, const char* end) {
+    while (v < end) {
+        while (v < end && (*v == ';' || *v == ' ' || *v == '\t')) v++;
+        const char* key = v;
+        while (v < end && *v != '=' && *v != ';') v++;
+        size_t key_len = v - key;
+        if (v >= end || *v != '=') continue;
+        v++;
+
+        const char* val = v;
+        size_t val_len;
+        if (v < end && *v == '"') {
+            val = ++v;
+            while (v < end && *v != '"') v++;
+            val_len = v - val;
+            if (v < end) v++;
+        } else {
+            while (v < end && *v != ';') v++;
+            val_len = v - val;
+        }
+
+        if (key_len == 4 && strncasecmp(key, "name", 4) == 0) {
+            copy_value(part->name, sizeof(part->name), val, val_len);
+            part->raw_name = val;
+            part->raw_name_len = val_len;
+        } else if (key_len == 8 && strncasecmp(key, "filename", 8) == 0) {
+            copy_value(part->filename, sizeof(part->filename), val, val_len);
+        }
+    }
+}
+
+static void parse_part_headers(MultipartPart* part, const char* p, const char* end) {
+    memset(part, 0, sizeof(*part));
+    while (p < end) {
+        const char* eol = memmem(p, end - p, "\r\n", 2);
+        if (!eol) eol = end;
+        const char* colon = memchr(p, ':', eol - p);
+        if (colon) {
+            const char* v = colon + 1;
+            while (v < eol && (*v == ' ' || *v == '\t')) v++;
+            size_t key_len = colon - p;
+            if (key_len == 19 && strncasecmp(p, "Content-Disposition", 19) == 0) {
+                parse_disposition(part, v, eol);
+            } else if (key_len == 12 && strncasecmp(p, "Content-Type", 12) == 0) {
+                copy_value(part->content_type, sizeof(part->content_type), v, eol - v);
+            }
+        }
+        p = eol + 2;
+    }
+}
+
+long multipart_parser_feed(MultipartParser* parser, const char* data, size_t len,
+                           const MultipartCallbacks* cb, void* ctx) {
+    size_t pos = 0;
+    while (1) {
+        const char* cur = data + pos;
+        size_t avail = len - pos;
+        switch (parser->state) {
+            case MULTIPART_START: {
+                // "--boundary" right at the start, without the CRLF of later delimiters
+                size_t m = parser->delim_len - 2;
+                size_t cmp = avail < m ? avail : m;
+                if (memcmp(cur, parser->delim + 2, cmp) == 0) {
+                    if (avail < m) return (long)pos;
+                    pos += m;
+                    parser->state = MULTIPART_AFTER_DELIM;
+                } else {
+                    parser->state = MULTIPART_PREAMBLE;
+                }
+                break;
+            }
+            case MULTIPART_PREAMBLE: {
+                long at = find_delim(parser, cur, avail);
+                if (at < 0) {
+                    return (long)(pos + safe_prefix(parser, cur, avail));
+                }
+                pos += at + parser->delim_len;
+                parser->state = MULTIPART_AFTER_DELIM;
+                break;
+            }
+            case MULTIPART_AFTER_DELIM:
+                if (avail < 2) return (long)pos;
+                if (cur[0] == '-' && cur[1] == '-') {
+                    parser->state = MULTIPART_DONE;
+                } else if (cur[0] == '\r' && cur[1] == '\n') {
+                    parser->state = MULTIPART_HEADERS;
+                } else {
+                    parser->state = MULTIPART_ERROR;
+                    break;
+                }
+                pos += 2;
+                break;
+            case MULTIPART_HEADERS: {
+                const char* end;
+                size_t block;
+                if (avail >= 2 && cur[0] == '\r' && cur[1] == '\n') {
+                    end = cur;  // No headers at all
+                    block = 2;
+                } else {
+                    end = memmem(cur, avail, "\r\n\r\n", 4);
+                    if (!end) {
+                        if (avail > MULTIPART_HEADERS_MAX) parser->state = MULTIPART_ERROR;
+                        else return (long)pos;
+                        break;
+                    }
+                    block = (end - cur) + 4;
+                }
+                if (block > MULTIPART_HEADERS_MAX) {
+                    parser->state = MULTIPART_ERROR;
+                    break;
+                }
+                parse_part_headers(&parser->part, cur, end);
+                pos += block;
+                parser->state = MULTIPART_DATA;
+                if (cb->on_part_begin && cb->on_part_begin(ctx, &parser->part) != 0) {
+                    parser->state = MULTIPART_ERROR;
+                }
+                break;
+            }
+            case MULTIPART_DATA: {
+                long at = find_delim(parser, cur, avail);
+                size_t take = at >= 0 ? (size_t)at : safe_prefix(parser, cur, avail);
+                if (take > 0 && cb->on_part_data && cb->on_part_data(ctx, cur, take) != 0) {
+                    parser->state = MULTIPART_ERROR;
+                    break;
+                }
+                pos += take;
+                if (at < 0) return (long)pos;
+                pos += parser->delim_len;
+                parser->state = MULTIPART_AFTER_DELIM;
+                if (cb->on_part_end && cb->on_part_end(ctx) != 0) {
+                    parser->state = MULTIPART_ERROR;
+                }
+                break;
+            }
+            case MULTIPART_DONE:
+                return (long)len; // Epilogue
+            case MULTIPART_ERROR:
+                return -1;
+        }
+    }
+}
+
+bool multipart_parser_finished(const MultipartParser* parser) {
+    return parser->state == MULTIPART_DONE;
+}
+
+int multipart_write_body_slice(const HttpRequest* req, const char* data, size_t len, int out_fd) {
+    if (req->body_spilled && data >= req->body && data + len <= req->body + req->content_length) {
+        // Spilled body: file-to-file inside the kernel, no trip through the mapping
+        loff_t off = data - req->body;
+        while (len > 0) {
+            ssize_t n = copy_file_range(req->body_fd, &off, out_fd, NULL, len, 0);
+            if (n > 0) {
+                data += n;
+                len -= n;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                break; // Unsupported here (e.g. EXDEV on old kernels): plain writes below
+            }
+        }
+    }
+    while (len > 0) {
+        ssize_t n = write(out_fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_system_rl(LOG_ERROR, "Multipart: write: %s", strerror(errno));
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// multipart_collect_fields(): the body is complete, so a part's data slices are contiguous
+typedef struct {
+    const MultipartPart* part;  // Non-NULL while collecting a field
+    const char* name;
+    size_t name_len;
+    const char* start;
+    size_t len;
+} FieldSlice;
+
+typedef struct {
+    FieldSlice fields[MAX_PARAMS];
+    int count;
+    int limit;
+} FieldCollector;
+
+static int collect_begin(void* ctx, const MultipartPart* part) {
+    FieldCollector* fc = ctx;
+    if (part->filename[0] == '\0' && part->raw_name && fc->count < fc->limit) {
+        FieldSlice* f = &fc->fields[fc->count];
+        f->part = part;
+        f->name = part->raw_name;
+        f->name_len = part->raw_name_len;
+        f->start = NULL;
+        f->len = 0;
+    }
+    return 0;
+}
+
+static int collect_data(void* ctx, const char* data, size_t len) {
+    FieldCollector* fc = ctx;
+    if (fc->count < fc->limit && fc->fields[fc->count].part) {
+        FieldSlice* f = &fc->fields[fc->count];
+        if (!f->start) f->start = data;
+        f->len += len;
+    }
+    return 0;
+}
+
+static int collect_end(void* ctx) {
+    FieldCollector* fc = ctx;
+    if (fc->count < fc->limit && fc->fields[fc->count].part) {
+        fc->count++;
+    }
+    return 0;
+}
+
+int multipart_collect_fields(HttpRequest* req, const char* content_type) {
+    MultipartParser parser;
+    if (!req->body || multipart_parser_init(&parser, content_type) != 0) {
+        return -1;
+    }
+    FieldCollector fc;
+    memset(&fc, 0, sizeof(fc));
+    fc.limit = MAX_PARAMS - req->body_param_count;
+    const MultipartCallbacks cb = { collect_begin, collect_data, collect_end };
+    long rc = multipart_parser_feed(&parser, req->body, req->content_length, &cb, &fc);
+    if (rc < 0 || !multipart_parser_finished(&parser)) {
+        log_system_rl(LOG_WARNING, "Multipart: Malformed multipart/form-data body.");
+        return -1;
+    }
+
+    // The delimiters must survive for handlers that walk the file parts, so the
+    // fields are copied out rather than terminated in place: one block for all
+    size_t total = 0;
+    for (int i = 0; i < fc.count; i++) {
+        total += fc.fields[i].name_len + fc.fields[i].len + 2;
+    }
+    if (fc.count == 0) return 0;
+    char* out = arena_alloc(&req->arena, total);
+    if (!out) return -1;
+    for (int i = 0; i < fc.count; i++) {
+        QueryParam* param = &req->body_params[req->body_param_count++];
+        param->key = out;
+        memcpy(out, fc.fields[i].name, fc.fields[i].name_len);
+        out += fc.fields[i].name_len;
+        *out++ = '\0';
+        param->value = out;
+        if (fc.fields[i].len) memcpy(out, fc.fields[i].start, fc.fields[i].len);
+        out += fc.fields[i].len;
+        *out++ = '\0';
+    }
+    return fc.count;
+}
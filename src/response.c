@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h> // For strcasecmp
+#include <stdint.h>  // For uintptr_t
 
 // ============================================================================
 // Status Code to Text Mapping
@@ -32,8 +33,12 @@ static const char* get_status_text(int status_code) {
         case 405: return "Method Not Allowed";
         case 409: return "Conflict";
         case 413: return "Payload Too Large";
+        case 414: return "URI Too Long";
         case 415: return "Unsupported Media Type";
+        case 417: return "Expectation Failed";
+        case 422: return "Unprocessable Entity";
         case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
         
         // 5xx Server Errors
         case 500: return "Internal Server Error";
@@ -121,22 +126,20 @@ void http_response_set_body_str(HttpResponse* res, const char* body) {
     }
 }
 
-void http_response_send(struct Connection* conn, HttpResponse* res, int epollFd) {
-    if (!conn || !res) return;
-    
-    // Build HTTP response string
-    // Estimate size: status line + headers + body
-    size_t header_buf_size = 1024;
+// Upper bound for the status line and headers of `res`, framing line included
+static size_t response_head_size(const HttpResponse* res) {
+    size_t size = 1024;
     for (int i = 0; i < res->header_count; i++) {
-        header_buf_size += strlen(res->headers[i].key) + strlen(res->headers[i].value) + 4;
-    }
-    
-    char* header_buf = (char*)malloc(header_buf_size);
-    if (!header_buf) {
-        log_system(LOG_ERROR, "Response: Failed to allocate header buffer");
-        return;
+        size += strlen(res->headers[i].key) + strlen(res->headers[i].value) + 4;
     }
-    
+    return size;
+}
+
+// Writes the status line and headers into buf (response_head_size() bytes) and
+// returns their length. `framing` is the header line that delimits the body
+// (Content-Length / Transfer-Encoding), or NULL for none.
+static size_t build_response_head(struct Connection* conn, const HttpResponse* res, const char* framing,
+                                  char* header_buf, size_t header_buf_size) {
     // Build status line
     int offset = snprintf(header_buf, header_buf_size,
                           "HTTP/1.1 %d %s\r\n",
@@ -151,9 +154,10 @@ void http_response_send(struct Connection* conn, HttpResponse* res, int epollFd)
                            "Connection: close\r\n");
     }
     
-    // Add Content-Length
-    offset += snprintf(header_buf + offset, header_buf_size - offset,
-                       "Content-Length: %zu\r\n", res->body_len);
+    // Add Content-Length / Transfer-Encoding
+    if (framing) {
+        offset += snprintf(header_buf + offset, header_buf_size - offset, "%s\r\n", framing);
+    }
     
     // Add custom headers
     for (int i = 0; i < res->header_count; i++) {
@@ -164,9 +168,33 @@ void http_response_send(struct Connection* conn, HttpResponse* res, int epollFd)
     
     // End of headers
     offset += snprintf(header_buf + offset, header_buf_size - offset, "\r\n");
-    
+    return (size_t)offset;
+}
+
+// Builds the status line and headers and queues them.
+static int queue_response_head(struct Connection* conn, HttpResponse* res, const char* framing, int epollFd) {
+    size_t header_buf_size = response_head_size(res);
+    char* header_buf = (char*)malloc(header_buf_size);
+    if (!header_buf) {
+        log_system(LOG_ERROR, "Response: Failed to allocate header buffer");
+        return -1;
+    }
+    size_t len = build_response_head(conn, res, framing, header_buf, header_buf_size);
+
     // Queue header for writing
-    queue_data_for_writing(conn, header_buf, offset, epollFd);
+    queue_data_for_writing(conn, header_buf, len, epollFd);
+    free(header_buf);
+    return 0;
+}
+
+void http_response_send(struct Connection* conn, HttpResponse* res, int epollFd) {
+    if (!conn || !res) return;
+    
+    char framing[64];
+    snprintf(framing, sizeof(framing), "Content-Length: %zu", res->body_len);
+    if (queue_response_head(conn, res, framing, epollFd) != 0) {
+        return;
+    }
     
     // Queue body for writing (if any)
     if (res->body && res->body_len > 0) {
@@ -175,8 +203,6 @@ void http_response_send(struct Connection* conn, HttpResponse* res, int epollFd)
     
     log_system(LOG_DEBUG, "Response: Sent %d %s with %zu bytes body",
                res->status_code, res->status_text, res->body_len);
-    
-    free(header_buf);
 }
 
 void http_response_free(HttpResponse* res) {
@@ -239,6 +265,8 @@ void http_send_error(struct Connection* conn, int status_code, const char* messa
 // Phase 3: JSON Document Response
 // ============================================================================
 
+#define JSON_WRITE_MIN 4096 // First guess for a serialized document
+
 void http_send_json_doc(struct Connection* conn, int status_code, yyjson_mut_doc* doc, int epollFd) {
     if (!doc) {
         log_system(LOG_WARNING, "Response: http_send_json_doc called with NULL document");
@@ -246,31 +274,156 @@ void http_send_json_doc(struct Connection* conn, int status_code, yyjson_mut_doc
         return;
     }
     
-    // Serialize the mutable document to string
+    // The document is written straight into the write queue, behind room for
+    // the head: no intermediate string, no copy of the body.
+    HttpResponse res;
+    http_response_init(&res, status_code);
+    http_response_set_content_type(&res, "application/json");
+    size_t head_max = response_head_size(&res);
+
+    // Whatever the buffer has free already is the first try
+    size_t room = head_max + 15;
+    size_t cap = conn->write_buf_size > conn->write_len + room ? conn->write_buf_size - conn->write_len - room : 0;
+    if (cap < JSON_WRITE_MIN) cap = JSON_WRITE_MIN;
+
     size_t json_len = 0;
-    char* json_str = yyjson_mut_write(doc, 0, &json_len);
-    
-    if (!json_str) {
-        log_system(LOG_ERROR, "Response: Failed to serialize JSON document");
+    size_t body_off = 0;
+    char* out = NULL;
+    yyjson_write_err err;
+    while (1) {
+        out = queue_reserve_for_writing(conn, room + cap);
+        if (!out) {
+            err.msg = "out of memory";
+            break;
+        }
+        // yyjson keeps its writer stack at the end of the buffer: align the start
+        body_off = (((uintptr_t)out + head_max + 15) & ~(uintptr_t)15) - (uintptr_t)out;
+        json_len = yyjson_mut_write_buf(out + body_off, cap, doc, 0, &err);
+        if (json_len > 0 || err.code != YYJSON_WRITE_ERROR_MEMORY_ALLOCATION) {
+            break;
+        }
+        cap *= 2; // Did not fit; rarely needed more than once
+    }
+
+    if (json_len == 0) {
+        http_response_free(&res);
+        log_system(LOG_ERROR, "Response: Failed to serialize JSON document: %s", err.msg);
         http_send_error(conn, 500, "Internal Server Error: JSON serialization failed", epollFd);
         return;
     }
-    
-    // Send the JSON response
+
+    // Head in the reserved room, ending where the body starts
+    char framing[64];
+    snprintf(framing, sizeof(framing), "Content-Length: %zu", json_len);
+    size_t head_len = build_response_head(conn, &res, framing, out, head_max);
+    memmove(out + body_off - head_len, out, head_len);
+    queue_commit_for_writing(conn, body_off - head_len, head_len + json_len, epollFd);
+    http_response_free(&res);
+
+    log_system(LOG_DEBUG, "Response: Sent JSON document (%zu bytes)", json_len);
+}
+
+void http_send_json_error(struct Connection* conn, int epollFd) {
+    const yyjson_read_err* err = &conn->request.json_err;
+    // yyjson's messages are plain ASCII literals without quotes
+    char body[256];
+    snprintf(body, sizeof(body), "{\"error\":\"Malformed JSON\",\"message\":\"%s\",\"position\":%zu}",
+             err->msg ? err->msg : "no JSON body", err->pos);
+    http_send_json(conn, 400, body, epollFd);
+}
+
+void http_send_json_template(struct Connection* conn, int status_code, const JsonTemplate* tpl,
+                             const JsonTplValue* values, int epollFd) {
+    if (!tpl) {
+        log_system(LOG_WARNING, "Response: http_send_json_template called with NULL template");
+        http_send_error(conn, 500, "Internal Server Error: NULL JSON template", epollFd);
+        return;
+    }
+
+    // The size bound is known up front: one reservation, head room in front
     HttpResponse res;
     http_response_init(&res, status_code);
     http_response_set_content_type(&res, "application/json");
-    http_response_set_body(&res, json_str, json_len);
-    http_response_send(conn, &res, epollFd);
+    size_t head_max = response_head_size(&res);
+    char* out = queue_reserve_for_writing(conn, head_max + json_template_max_size(tpl, values));
+    if (!out) {
+        http_response_free(&res);
+        log_system(LOG_ERROR, "Response: Out of memory rendering JSON template");
+        http_send_error(conn, 500, "Internal Server Error", epollFd);
+        return;
+    }
+    size_t json_len = json_template_render(tpl, values, out + head_max);
+
+    char framing[64];
+    snprintf(framing, sizeof(framing), "Content-Length: %zu", json_len);
+    size_t head_len = build_response_head(conn, &res, framing, out, head_max);
+    memmove(out + head_max - head_len, out, head_len);
+    queue_commit_for_writing(conn, head_max - head_len, head_len + json_len, epollFd);
     http_response_free(&res);
-    
-    // Free the serialized string (allocated by yyjson)
-    free(json_str);
-    
-    log_system(LOG_DEBUG, "Response: Sent JSON document (%zu bytes)", json_len);
+
+    log_system(LOG_DEBUG, "Response: Sent JSON template (%zu bytes)", json_len);
 }
 
+// ============================================================================
+// Streaming Response API Implementation
+// ============================================================================
 
+int http_response_begin_chunked(struct Connection* conn, HttpResponse* res, int epollFd) {
+    if (!conn || !res || conn->response_streaming) return -1;
 
+    // HTTP/1.0 has no chunked encoding: the end of the body is the end of the connection
+    conn->response_chunked = conn->request.minor_version >= 1;
+    if (!conn->response_chunked) {
+        conn->request.keep_alive = false;
+    }
+    if (queue_response_head(conn, res, conn->response_chunked ? "Transfer-Encoding: chunked" : NULL, epollFd) != 0) {
+        return -1;
+    }
+    conn->response_streaming = true;
+    log_system(LOG_DEBUG, "Response: Started streaming %d %s (chunked=%d)",
+               res->status_code, res->status_text, conn->response_chunked);
+    return 0;
+}
 
+int http_response_write_chunk(struct Connection* conn, const char* data, size_t len, int epollFd) {
+    if (!conn || !conn->response_streaming) return -1;
+    if (!data || len == 0) return 0;
 
+    if (conn->response_chunked) {
+        char size_line[24];
+        int n = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+        queue_data_for_writing(conn, size_line, n, epollFd);
+        queue_data_for_writing(conn, data, len, epollFd);
+        queue_data_for_writing(conn, "\r\n", 2, epollFd);
+    } else {
+        queue_data_for_writing(conn, data, len, epollFd);
+    }
+    return 0;
+}
+
+int http_response_end(struct Connection* conn, int epollFd) {
+    if (!conn || !conn->response_streaming) return -1;
+
+    conn->response_streaming = false;
+    conn->on_drain = NULL;
+    conn->drain_ctx = NULL;
+    // Zero-length for HTTP/1.0 still arms EPOLLOUT, which lets handleWrite finish the response
+    queue_data_for_writing(conn, "0\r\n\r\n", conn->response_chunked ? 5 : 0, epollFd);
+    log_system(LOG_DEBUG, "Response: Finished streaming response on fd %d", conn->fd);
+    return 0;
+}
+
+void http_response_on_drain(struct Connection* conn, ResponseDrainFn fn, void* ctx) {
+    if (!conn) return;
+    conn->on_drain = fn;
+    conn->drain_ctx = ctx;
+}
+
+size_t http_response_pending(const struct Connection* conn) {
+    if (!conn) return 0;
+    size_t pending = conn->write_len - conn->write_pos;
+    if (conn->write_map) {
+        pending += conn->write_map_end - conn->write_map_pos; // Borrowed static file bytes
+    }
+    return pending;
+}
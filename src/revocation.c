@@ -0,0 +1,419 @@
+#define _DEFAULT_SOURCE // For strdup, getline
+#include "revocation.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "logger.h"
+
+// ============================================================================
+// Design
+// ============================================================================
+// Revocations are rare and checks happen on every authenticated request, so
+// the set is split in two:
+//   - A blocked Bloom filter: each key sets 6 bits inside one 64-byte block,
+//     so a negative answer touches a single cache line per key.
+//   - An exact open-addressing table, consulted only on filter hits.
+// Bloom filters cannot delete, so expired entries are purged by rebuilding
+// both structures (on growth and at most once a minute, see revocation_tick()).
+// The snapshot is rewritten from the same tick, at most once a minute, rather
+// than on every revocation. The reactor is single-threaded, so no locking.
+
+#define BLOOM_BLOCK_WORDS 8          // 8 x 64 bits = one 64-byte cache line
+#define BLOOM_BITS_PER_KEY 6
+#define BLOOM_MIN_BLOCKS 64          // 4 KiB, ~400 keys at ~1% false positives
+#define TABLE_MIN_CAPACITY 64        // Power of two
+#define PRUNE_INTERVAL_SECONDS 60
+
+typedef enum {
+    REVOKE_TOKEN_ID = 'J',  // key = jti, value = exp
+    REVOKE_USER = 'U'       // key = sub, value = issued_before
+} RevocationKind;
+
+typedef struct {
+    uint64_t hash;
+    char* key;          // NULL = empty slot
+    char kind;
+    time_t value;
+    time_t expire_at;   // Entry can be dropped after this time
+} RevocationEntry;
+
+static struct {
+    uint64_t* bloom;           // bloom_blocks * BLOOM_BLOCK_WORDS words
+    size_t bloom_blocks;       // Power of two
+    RevocationEntry* table;
+    size_t capacity;           // Power of two
+    size_t count;
+    time_t next_prune;
+    bool dirty;                // Revocations not yet in the snapshot
+    time_t next_save;          // Earliest time for the next snapshot write
+    char snapshot_path[256];
+} RV;
+
+// FNV-1a over the kind tag and the key, followed by a splitmix64 finalizer
+// so every bit of the result is usable for block and bit selection.
+static uint64_t revocation_hash(char kind, const char* key) {
+    uint64_t h = 14695981039346656037ULL;
+    h ^= (unsigned char)kind;
+    h *= 1099511628211ULL;
+    for (const unsigned char* p = (const unsigned char*)key; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// --- Blocked Bloom filter ---
+
+static void bloom_add(uint64_t hash) {
+    uint64_t* block = RV.bloom + (hash & (RV.bloom_blocks - 1)) * BLOOM_BLOCK_WORDS;
+    uint64_t bits = hash >> 10; // Upper 54 bits: 6 probes x 9 bits (0..511)
+    for (int i = 0; i < BLOOM_BITS_PER_KEY; i++) {
+        unsigned int bit = (unsigned int)(bits >> (i * 9)) & 511;
+        block[bit >> 6] |= 1ULL << (bit & 63);
+    }
+}
+
+static bool bloom_may_contain(uint64_t hash) {
+    if (!RV.bloom) return false;
+    const uint64_t* block = RV.bloom + (hash & (RV.bloom_blocks - 1)) * BLOOM_BLOCK_WORDS;
+    uint64_t bits = hash >> 10;
+    for (int i = 0; i < BLOOM_BITS_PER_KEY; i++) {
+        unsigned int bit = (unsigned int)(bits >> (i * 9)) & 511;
+        if (!(block[bit >> 6] & (1ULL << (bit & 63)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- Exact table ---
+
+static RevocationEntry* table_find(char kind, const char* key, uint64_t hash) {
+    if (!RV.table) return NULL;
+    size_t mask = RV.capacity - 1;
+    for (size_t i = hash & mask; RV.table[i].key; i = (i + 1) & mask) {
+        RevocationEntry* e = &RV.table[i];
+        if (e->hash == hash && e->kind == kind && strcmp(e->key, key) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// Inserts without growing; the caller guarantees a free slot.
+static void table_place(RevocationEntry* entries, size_t capacity, const RevocationEntry* entry) {
+    size_t mask = capacity - 1;
+    size_t i = entry->hash & mask;
+    while (entries[i].key) {
+        i = (i + 1) & mask;
+    }
+    entries[i] = *entry;
+}
+
+/**
+ * Rebuilds the table and filter with room for `needed` live entries,
+ * dropping entries that expired before `now`.
+ */
+static int rebuild(size_t needed, time_t now) {
+    size_t capacity = TABLE_MIN_CAPACITY;
+    while (capacity < needed * 2) capacity *= 2;  // Load factor <= 0.5
+    size_t blocks = BLOOM_MIN_BLOCKS;
+    while (blocks * 512 < needed * 10) blocks *= 2;   // ~10 bits per key
+
+    RevocationEntry* table = calloc(capacity, sizeof(RevocationEntry));
+    uint64_t* bloom = calloc(blocks * BLOOM_BLOCK_WORDS, sizeof(uint64_t));
+    if (!table || !bloom) {
+        free(table);
+        free(bloom);
+        return -1;
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < RV.capacity; i++) {
+        RevocationEntry* e = &RV.table[i];
+        if (!e->key) continue;
+        if (e->expire_at <= now) {
+            free(e->key);
+            continue;
+        }
+        table_place(table, capacity, e);
+        count++;
+    }
+
+    free(RV.table);
+    free(RV.bloom);
+    RV.table = table;
+    RV.capacity = capacity;
+    RV.count = count;
+    RV.bloom = bloom;
+    RV.bloom_blocks = blocks;
+    for (size_t i = 0; i < capacity; i++) {
+        if (table[i].key) bloom_add(table[i].hash);
+    }
+    RV.next_prune = now + PRUNE_INTERVAL_SECONDS;
+    return 0;
+}
+
+static void revocation_reset() {
+    for (size_t i = 0; i < RV.capacity; i++) {
+        free(RV.table[i].key);
+    }
+    free(RV.table);
+    free(RV.bloom);
+    RV.table = NULL;
+    RV.bloom = NULL;
+    RV.capacity = 0;
+    RV.count = 0;
+    RV.bloom_blocks = 0;
+}
+
+// Adds or updates an entry, without persisting.
+static int revocation_insert(char kind, const char* key, time_t value, time_t expire_at, time_t now) {
+    if (!key || !*key) {
+        return -1;
+    }
+    if (expire_at <= now) {
+        return 0; // Already expired: nothing to remember
+    }
+
+    uint64_t hash = revocation_hash(kind, key);
+    RevocationEntry* existing = table_find(kind, key, hash);
+    if (existing) {
+        // Keep the broadest revocation
+        if (value > existing->value) existing->value = value;
+        if (expire_at > existing->expire_at) existing->expire_at = expire_at;
+        return 0;
+    }
+
+    if (!RV.table || (RV.count + 1) * 2 > RV.capacity || now >= RV.next_prune) {
+        if (rebuild(RV.count + 1, now) != 0) {
+            log_system(LOG_ERROR, "Revocation: Out of memory, cannot revoke '%s'.", key);
+            return -1;
+        }
+    }
+
+    RevocationEntry entry = { hash, strdup(key), kind, value, expire_at };
+    if (!entry.key) return -1;
+    table_place(RV.table, RV.capacity, &entry);
+    RV.count++;
+    bloom_add(hash);
+    return 0;
+}
+
+// --- Snapshot ---
+// Plain text, one entry per line: "<kind> <value> <expire_at> <key>\n". The key
+// runs to end of line; '%' and control bytes in it are written as %XX, so a
+// claim cannot break or add lines. Written to a temporary file that is synced
+// and renamed, so a crash never leaves a torn snapshot.
+
+static void write_key(FILE* fp, const char* key) {
+    for (const unsigned char* p = (const unsigned char*)key; *p; p++) {
+        if (*p < 0x20 || *p == 0x7f || *p == '%') {
+            fprintf(fp, "%%%02X", *p);
+        } else {
+            fputc(*p, fp);
+        }
+    }
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Undoes write_key() in place
+static void read_key(char* key) {
+    char* out = key;
+    for (char* p = key; *p; p++) {
+        int hi, lo;
+        if (*p == '%' && (hi = hex_value(p[1])) >= 0 && (lo = hex_value(p[2])) >= 0) {
+            *out++ = (char)((hi << 4) | lo);
+            p += 2;
+        } else {
+            *out++ = *p;
+        }
+    }
+    *out = '\0';
+}
+
+// Makes the rename itself durable
+static void sync_parent_dir(const char* path) {
+    char dir[256];
+    const char* slash = strrchr(path, '/');
+    if (!slash) {
+        snprintf(dir, sizeof(dir), ".");
+    } else if (slash == path) {
+        snprintf(dir, sizeof(dir), "/");
+    } else {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+    }
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd != -1) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+static int revocation_save() {
+    if (RV.snapshot_path[0] == '\0') {
+        return 0;
+    }
+
+    char tmp_path[300];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", RV.snapshot_path);
+    FILE* fp = fopen(tmp_path, "w");
+    if (!fp) {
+        log_system(LOG_ERROR, "Revocation: Cannot write snapshot '%s': %s", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    time_t now = time(NULL);
+    for (size_t i = 0; i < RV.capacity; i++) {
+        RevocationEntry* e = &RV.table[i];
+        if (!e->key || e->expire_at <= now) continue;
+        fprintf(fp, "%c %lld %lld ", e->kind, (long long)e->value, (long long)e->expire_at);
+        write_key(fp, e->key);
+        fputc('\n', fp);
+    }
+
+    bool written = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    if (fclose(fp) != 0 || !written || rename(tmp_path, RV.snapshot_path) != 0) {
+        log_system(LOG_ERROR, "Revocation: Failed to replace snapshot '%s': %s", RV.snapshot_path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+    sync_parent_dir(RV.snapshot_path);
+    return 0;
+}
+
+int revocation_tick() {
+    if (!RV.dirty && RV.count == 0) {
+        return -1;
+    }
+    time_t now = time(NULL);
+    if (now >= RV.next_prune && RV.table) {
+        rebuild(RV.count, now); // On failure the old set stays, retried next tick
+    }
+    if (RV.dirty && now >= RV.next_save) {
+        // A failed write is retried on the next interval
+        RV.dirty = revocation_save() != 0;
+        RV.next_save = now + PRUNE_INTERVAL_SECONDS;
+    }
+    if (!RV.dirty) {
+        return -1; // Pruning alone can wait for the next insert or event
+    }
+    return (int)(RV.next_save - now) * 1000;
+}
+
+static int mark_dirty() {
+    RV.dirty = true;
+    return 0;
+}
+
+int revocation_init(const char* snapshot_path) {
+    if (RV.dirty) {
+        revocation_save(); // Still under the old path
+        RV.dirty = false;
+    }
+    revocation_reset();
+    snprintf(RV.snapshot_path, sizeof(RV.snapshot_path), "%s", snapshot_path ? snapshot_path : "");
+
+    time_t now = time(NULL);
+    if (rebuild(0, now) != 0) {
+        return -1;
+    }
+    if (RV.snapshot_path[0] == '\0') {
+        return 0;
+    }
+
+    FILE* fp = fopen(RV.snapshot_path, "r");
+    if (!fp) {
+        if (errno == ENOENT) {
+            return 0; // First start, nothing revoked yet
+        }
+        log_system(LOG_ERROR, "Revocation: Cannot read snapshot '%s': %s", RV.snapshot_path, strerror(errno));
+        return -1;
+    }
+
+    // Escaped keys can be three times their length, so lines have no fixed bound
+    char* line = NULL;
+    size_t line_cap = 0;
+    int loaded = 0;
+    while (getline(&line, &line_cap, fp) != -1) {
+        char kind;
+        long long value, expire_at;
+        int key_offset = 0;
+        if (sscanf(line, "%c %lld %lld %n", &kind, &value, &expire_at, &key_offset) != 3 || key_offset == 0) {
+            continue;
+        }
+        char* key = line + key_offset;
+        key[strcspn(key, "\r\n")] = '\0';
+        read_key(key);
+        if (kind != REVOKE_TOKEN_ID && kind != REVOKE_USER) {
+            continue;
+        }
+        if (expire_at > now && revocation_insert(kind, key, (time_t)value, (time_t)expire_at, now) == 0) {
+            loaded++;
+        }
+    }
+    free(line);
+    fclose(fp);
+
+    log_system(LOG_INFO, "Revocation: Loaded %d active entries from '%s'.", loaded, RV.snapshot_path);
+    return 0;
+}
+
+int revocation_add_token_id(const char* jti, time_t exp) {
+    time_t now = time(NULL);
+    if (revocation_insert(REVOKE_TOKEN_ID, jti, exp, exp, now) != 0) {
+        return -1;
+    }
+    log_system(LOG_INFO, "Revocation: Revoked token id '%s'.", jti);
+    return mark_dirty();
+}
+
+int revocation_add_user(const char* username, time_t issued_before, time_t expires) {
+    time_t now = time(NULL);
+    if (revocation_insert(REVOKE_USER, username, issued_before, expires, now) != 0) {
+        return -1;
+    }
+    log_system(LOG_INFO, "Revocation: Revoked tokens of user '%s' issued before %lld.", username, (long long)issued_before);
+    return mark_dirty();
+}
+
+bool revocation_is_revoked(const char* jti, const char* username, time_t iat) {
+    if (RV.count == 0) {
+        return false;
+    }
+    time_t now = 0;
+
+    if (jti) {
+        uint64_t hash = revocation_hash(REVOKE_TOKEN_ID, jti);
+        if (bloom_may_contain(hash)) {
+            now = time(NULL);
+            RevocationEntry* e = table_find(REVOKE_TOKEN_ID, jti, hash);
+            if (e && e->expire_at > now) return true;
+        }
+    }
+
+    if (username) {
+        uint64_t hash = revocation_hash(REVOKE_USER, username);
+        if (bloom_may_contain(hash)) {
+            if (now == 0) now = time(NULL);
+            RevocationEntry* e = table_find(REVOKE_USER, username, hash);
+            if (e && e->expire_at > now && iat < e->value) return true;
+        }
+    }
+    return false;
+}
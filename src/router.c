@@ -3,20 +3,15 @@
 #include <string.h>
 #include <stdlib.h>
 #include "logger.h" // Add logger for debug messages
+#include "json_schema.h"
 
 #define MAX_ROUTES 64
 
-// Simple structure to hold a single route
-typedef struct {
-    char* method;
-    char* path;
-    RouteHandler handler;
-} Route;
-
 // Global routing table
 static struct {
     Route routes[MAX_ROUTES];
     int count;
+    int failed; // Registrations that were rejected; startServer() refuses to run
 } R;
 
 void router_init() {
@@ -25,28 +20,83 @@ void router_init() {
     memset(&R, 0, sizeof(R));
 }
 
-void router_add_route(const char* method, const char* path, RouteHandler handler) {
+int router_add_route(const char* method, const char* path, RouteHandler handler) {
+    return router_add_route_ex(method, path, handler, NULL);
+}
+
+// Registers a plain (handler) or streaming (stream) route.
+static int add_route(const char* method, const char* path, RouteHandler handler,
+                     const StreamHandler* stream, const RouteOptions* options) {
     if (R.count < MAX_ROUTES) {
+        JsonSchema* schema = NULL;
+        if (options && options->json_schema && !stream) {
+            char err[256];
+            schema = json_schema_compile(options->json_schema, err, sizeof(err));
+            if (!schema) {
+                // Dropping the route would silently hand the path to the static file handler
+                log_system(LOG_ERROR, "Router: Invalid JSON schema for [%s] %s: %s", method, path, err);
+                R.failed++;
+                return -1;
+            }
+        }
         // We must duplicate the strings, as the originals may not be persistent
-        R.routes[R.count].method = strdup(method);
-        R.routes[R.count].path = strdup(path);
-        R.routes[R.count].handler = handler;
+        Route* route = &R.routes[R.count];
+        route->method = strdup(method);
+        route->path = strdup(path);
+        route->handler = handler;
+        route->schema = schema;
+        if (stream) {
+            route->stream = *stream;
+        }
+        if (options) {
+            route->options.roles = options->roles ? strdup(options->roles) : NULL;
+            route->options.auth_required = options->auth_required || options->roles;
+            route->options.max_body_size = options->max_body_size;
+        }
         R.count++;
-        log_system(LOG_DEBUG, "Router: Registered route [%s] %s", method, path);
-    } else {
-        log_system(LOG_ERROR, "Router: Could not add route [%s] %s, routing table full.", method, path);
+        log_system(LOG_DEBUG, "Router: Registered route [%s] %s%s%s", method, path,
+                   route->options.auth_required ? " (auth required)" : "",
+                   schema ? " (JSON schema)" : "");
+        return 0;
     }
+    log_system(LOG_ERROR, "Router: Could not add route [%s] %s, routing table full.", method, path);
+    R.failed++;
+    return -1;
 }
 
-RouteHandler router_find_handler(const char* method, const char* path) {
+const Route* router_find_route(const char* method, const char* path) {
+    if (!method || !path) return NULL;
     for (int i = 0; i < R.count; i++) {
         // Simple string comparison for now.
         // A more advanced router might support wildcards or regex.
         if (strcmp(R.routes[i].method, method) == 0 && strcmp(R.routes[i].path, path) == 0) {
             log_system(LOG_DEBUG, "Router: Matched request to handler for [%s] %s", method, path);
-            return R.routes[i].handler;
+            return &R.routes[i];
         }
     }
     log_system(LOG_DEBUG, "Router: No matching handler found for [%s] %s", method, path);
     return NULL;
+}
+
+int router_add_route_ex(const char* method, const char* path, RouteHandler handler, const RouteOptions* options) {
+    return add_route(method, path, handler, NULL, options);
+}
+
+int router_add_stream_route(const char* method, const char* path, const StreamHandler* stream,
+                            const RouteOptions* options) {
+    if (!stream || !stream->on_body_chunk || !stream->on_complete) {
+        log_system(LOG_ERROR, "Router: Stream route [%s] %s needs on_body_chunk and on_complete.", method, path);
+        R.failed++;
+        return -1;
+    }
+    return add_route(method, path, NULL, stream, options);
+}
+
+int router_failed_count() {
+    return R.failed;
+}
+
+RouteHandler router_find_handler(const char* method, const char* path) {
+    const Route* route = router_find_route(method, path);
+    return route ? route->handler : NULL;
 } 
\ No newline at end of file
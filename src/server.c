@@ -9,6 +9,8 @@
 #include <errno.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <signal.h>
 #include "http.h"
 #include "logger.h"
 #include "config.h"
@@ -17,9 +19,19 @@
 #include "utils.h"
 #include <stdbool.h>
 #include "router.h" // Include our new router
+#include "auth.h" // For auth_needs_worker_pool, auth_context_clear, route middleware
+#include "response.h"
+#include "worker_pool.h"
+#include "body_spill.h"
+#include "json_schema.h"
+#include "mime.h"
+#include "file_cache.h"
+#include "revocation.h"
+#include <sys/uio.h>
 
 #define MAX_EVENTS 64
 #define INITIAL_BUF_SIZE 4096
+#define STREAM_BUFFER_SIZE (64 * 1024) // Unconsumed body bytes held for a stream handler
 
 // Forward declarations
 static void handleConnection(Connection* conn, ServerConfig* config, int epollFd);
@@ -76,6 +88,22 @@ static int createAndBind(int port) {
     return listenFd;
 }
 
+// Blocks SIGUSR1 and returns a non-blocking signalfd that reports it, or -1.
+static int createSignalFd() {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1) {
+        log_system(LOG_WARNING, "sigprocmask: %s", strerror(errno));
+        return -1;
+    }
+    int sigFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sigFd == -1) {
+        log_system(LOG_WARNING, "signalfd: %s", strerror(errno));
+    }
+    return sigFd;
+}
+
 void startServer(const char* configFilePath) {
     ServerConfig config;
     loadConfig(configFilePath, &config);
@@ -84,10 +112,26 @@ void startServer(const char* configFilePath) {
         fprintf(stderr, "Failed to initialize logger.\n");
         return;
     }
+    logger_set_limits(config.log_rate_limit > 0 ? config.log_rate_limit : 0,
+                      config.access_log_sample_rate > 0 ? config.access_log_sample_rate : 1);
+    logger_set_rotation(config.log_rotate_size_mb > 0 ? (size_t)config.log_rotate_size_mb * 1024 * 1024 : 0,
+                        config.log_rotate_daily != 0);
+
+    if (router_failed_count() > 0) {
+        log_system(LOG_ERROR, "%d route(s) failed to register, refusing to start.", router_failed_count());
+        return;
+    }
 
     log_system(LOG_INFO, "Server starting with configuration:");
     log_system(LOG_INFO, "  - Port: %d", config.listen_port);
     log_system(LOG_INFO, "  - DocumentRoot: %s", config.document_root);
+    body_spill_init(&config);
+    mime_init(&config);
+    if (http_static_init(&config) != 0) {
+        log_system(LOG_ERROR, "DocumentRoot '%s' is unusable, refusing to start.", config.document_root);
+        return;
+    }
+    file_cache_init(&config);
     
     // We need to pass the DocumentRoot to the http module.
     // For now, let's assume http.c can access it.
@@ -124,13 +168,64 @@ void startServer(const char* configFilePath) {
         return;
     }
 
+    // SIGUSR1 asks us to reopen the log files (e.g. after logrotate moved them).
+    // It is delivered through a signalfd so the reopen runs on the reactor thread
+    // between events instead of interrupting a request in an async signal handler.
+    int sigFd = createSignalFd();
+    if (sigFd != -1) {
+        event.data.fd = sigFd;
+        event.events = EPOLLIN;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, sigFd, &event) == -1) {
+            log_system(LOG_WARNING, "epoll_ctl: sigFd: %s", strerror(errno));
+            close(sigFd);
+            sigFd = -1;
+        }
+    }
+
+    // Asymmetric JWT checks run on worker threads; their completions wake us via an eventfd
+    int poolFd = -1;
+    if (auth_needs_worker_pool(&config) && worker_pool_init(config.jwt_verify_threads) == 0) {
+        poolFd = worker_pool_event_fd();
+        event.data.fd = poolFd;
+        event.events = EPOLLIN;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, poolFd, &event) == -1) {
+            log_system(LOG_WARNING, "epoll_ctl: poolFd: %s", strerror(errno));
+            worker_pool_shutdown();
+            poolFd = -1;
+        }
+    }
+
+    // Static file changes drop the files' shared mappings
+    int inotifyFd = file_cache_event_fd();
+    if (inotifyFd != -1) {
+        event.data.fd = inotifyFd;
+        event.events = EPOLLIN;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, inotifyFd, &event) == -1) {
+            log_system(LOG_WARNING, "epoll_ctl: inotifyFd: %s", strerror(errno));
+            inotifyFd = -1;
+        }
+    }
+
     struct epoll_event events[MAX_EVENTS];
 
     log_system(LOG_INFO, "Server is running...");
+    int timeout = -1;
     while (1) {
-        int n = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        int n = epoll_wait(epollFd, events, MAX_EVENTS, timeout);
         for (int i = 0; i < n; i++) {
-            if (events[i].data.fd == listenFd) {
+            if (sigFd != -1 && events[i].data.fd == sigFd) {
+                struct signalfd_siginfo info;
+                while (read(sigFd, &info, sizeof(info)) == sizeof(info)) {
+                    if (info.ssi_signo == SIGUSR1) {
+                        log_system(LOG_INFO, "Server: Received SIGUSR1, reopening log files.");
+                        logger_reopen();
+                    }
+                }
+            } else if (poolFd != -1 && events[i].data.fd == poolFd) {
+                worker_pool_run_completions();
+            } else if (inotifyFd != -1 && events[i].data.fd == inotifyFd) {
+                file_cache_handle_events();
+            } else if (events[i].data.fd == listenFd) {
                 while (1) {
                     struct sockaddr_in client_addr;
                     socklen_t client_len = sizeof(client_addr);
@@ -154,21 +249,40 @@ void startServer(const char* configFilePath) {
                     conn->write_buf_size = INITIAL_BUF_SIZE;
                     conn->write_len = 0;
                     conn->write_pos = 0;
+                    conn->write_armed = false;
+                    conn->response_streaming = false;
+                    conn->response_chunked = false;
+                    conn->on_drain = NULL;
+                    conn->drain_ctx = NULL;
+                    conn->write_map = NULL;
+                    conn->write_map_pos = 0;
+                    conn->write_map_end = 0;
                     conn->parsing_state = PARSE_STATE_REQ_LINE;
                     conn->parsed_offset = 0;
                     memset(&conn->request, 0, sizeof(HttpRequest));
+                    memset(&conn->auth, 0, sizeof(AuthContext));
+                    conn->async_pending = 0;
+                    conn->closed = false;
+                    conn->read_deferred = false;
+                    conn->body_restore = false;
+                    conn->in_middleware = false;
                     
                     struct epoll_event client_event;
                     client_event.data.ptr = conn;
                     client_event.events = EPOLLIN | EPOLLET | EPOLLRDHUP; // EPOLLRDHUP 代表 对端（客户端）关闭了连接，或者半关闭了写端 的事件，可更早资源回收。
                     epoll_ctl(epollFd, EPOLL_CTL_ADD, connFd, &client_event);
                 }
-            } else if (events[i].events & EPOLLIN) {
-                Connection* conn = (Connection*)events[i].data.ptr;
-                handleConnection(conn, &config, epollFd);
             } else if (events[i].events & EPOLLOUT) {
                 Connection* conn = (Connection*)events[i].data.ptr;
+                // Both edges may arrive together; the parser is idle while a response
+                // is queued, so the input is read once it has been sent (see handleWrite)
+                if (events[i].events & EPOLLIN) {
+                    conn->read_deferred = true;
+                }
                 handleWrite(conn, &config, epollFd);
+            } else if (events[i].events & EPOLLIN) {
+                Connection* conn = (Connection*)events[i].data.ptr;
+                handleConnection(conn, &config, epollFd);
             } else {
                 // Handle other events like EPOLLRDHUP, EPOLLERR
                 Connection* conn = (Connection*)events[i].data.ptr;
@@ -176,33 +290,109 @@ void startServer(const char* configFilePath) {
                 closeConnection(conn, epollFd);
             }
         }
+        // Size/daily rotation runs here, between event batches
+        logger_rotate_if_needed();
+        // Batched revocation snapshot writes; wakes us up while one is pending
+        timeout = revocation_tick();
     }
     log_system(LOG_INFO, "Server shutting down.");
+    worker_pool_shutdown();
+    if (sigFd != -1) close(sigFd);
     close(epollFd);
     close(listenFd);
     logger_shutdown();
 }
 
+static bool isStreamingRoute(const Route* route) {
+    return route && route->stream.on_complete;
+}
+
+// Largest body the matched route accepts, 0 = unlimited
+static size_t bodyLimit(const Connection* conn, const ServerConfig* config) {
+    const Route* route = conn->request.route;
+    return (route && route->options.max_body_size) ? route->options.max_body_size : config->max_body_size;
+}
+
+// A streamed request ends here without on_complete (disconnect or rejection)
+static void abortStream(Connection* conn) {
+    if (conn->request.stream_started) {
+        conn->request.stream_started = false;
+        const Route* route = conn->request.route;
+        if (route->stream.on_abort) {
+            route->stream.on_abort(conn);
+        }
+    }
+}
+
+static void releaseWriteMap(Connection* conn) {
+    if (conn->write_map) {
+        file_cache_release(conn->write_map);
+        conn->write_map = NULL;
+        conn->write_map_pos = 0;
+        conn->write_map_end = 0;
+    }
+}
+
+static void freeConnection(Connection* conn) {
+    abortStream(conn);
+    if (conn->on_drain) {
+        // A streaming response producer is waiting for us; let it release its state
+        conn->on_drain(NULL, conn->drain_ctx, -1);
+    }
+    releaseWriteMap(conn);
+    freeHttpRequest(&conn->request);
+    arena_destroy(&conn->request.arena);
+    auth_context_clear(conn);
+    free(conn->read_buf);
+    free(conn->write_buf);
+    free(conn);
+}
+
 static void closeConnection(Connection* conn, int epollFd) {
-    if (conn) {
+    if (conn && !conn->closed) {
         log_system(LOG_DEBUG, "Server: Closing connection fd=%d", conn->fd);
         // It's good practice to unregister from epoll before closing the fd
         epoll_ctl(epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
         close(conn->fd);
-        freeHttpRequest(&conn->request);
-        free(conn->read_buf);
-        free(conn->write_buf);
-        free(conn);
+        if (conn->async_pending > 0) {
+            // A worker job still refers to us; server_async_end() frees the rest
+            conn->closed = true;
+            conn->fd = -1;
+            return;
+        }
+        freeConnection(conn);
     }
 }
 
+void server_async_begin(struct Connection* conn) {
+    conn->async_pending++;
+}
+
+int server_async_end(struct Connection* conn) {
+    conn->async_pending--;
+    if (conn->closed) {
+        if (conn->async_pending == 0) {
+            freeConnection(conn);
+        }
+        return -1;
+    }
+    return 0;
+}
+
 // Reset connection state for Keep-Alive: compact buffer, reset parser, prepare for next request
 static void resetConnectionForNextRequest(Connection* conn) {
     log_system(LOG_DEBUG, "Server: Resetting connection fd=%d for next request. parsed_offset=%zu, read_len=%zu",
                conn->fd, conn->parsed_offset, conn->read_len);
     
     // 1. Free the old request's dynamically allocated data
+    abortStream(conn);
     freeHttpRequest(&conn->request);
+
+    // An async handler kept the body NUL-terminated until now
+    if (conn->body_restore) {
+        conn->read_buf[conn->parsed_offset] = conn->body_saved_char;
+        conn->body_restore = false;
+    }
     
     // 2. Compact read buffer: move remaining data (next request's partial data) to the front
     size_t remaining = conn->read_len - conn->parsed_offset;
@@ -212,67 +402,143 @@ static void resetConnectionForNextRequest(Connection* conn) {
     }
     conn->read_len = remaining;
     conn->parsed_offset = 0;
+
+    // Give back a buffer that grew for a large body, it is not needed for headers
+    if (conn->read_buf_size > MAX_HEADER_SIZE + 1 && remaining < INITIAL_BUF_SIZE) {
+        char* small_buf = (char*)realloc(conn->read_buf, INITIAL_BUF_SIZE);
+        if (small_buf) { // On failure the large buffer simply stays in use
+            conn->read_buf = small_buf;
+            conn->read_buf_size = INITIAL_BUF_SIZE;
+        }
+    }
     
     // 3. Reset write buffer (already sent, so just clear pointers)
     conn->write_len = 0;
     conn->write_pos = 0;
     
     // 4. Reset parser state
+    // (freeHttpRequest() above already cleared the request and reset its arena)
     conn->parsing_state = PARSE_STATE_REQ_LINE;
-    memset(&conn->request, 0, sizeof(HttpRequest));
     
     log_system(LOG_DEBUG, "Server: Connection fd=%d reset complete. Remaining buffer: %zu bytes.", conn->fd, conn->read_len);
 }
 
+// Closing a socket with unread input makes the kernel send RST, which can destroy
+// a response (413, 431, ...) the peer has not read yet. Discard what already
+// arrived, bounded so a client cannot keep us here.
+static void discardPendingInput(Connection* conn) {
+    char scratch[4096];
+    size_t discarded = 0;
+    ssize_t n;
+    shutdown(conn->fd, SHUT_WR);
+    while (discarded < 1024 * 1024 && (n = read(conn->fd, scratch, sizeof(scratch))) > 0) {
+        discarded += n;
+    }
+}
+
+// Stop watching EPOLLOUT, keep listening for EPOLLIN
+static void disarmWrite(Connection* conn, int epollFd) {
+    struct epoll_event event;
+    event.data.ptr = conn;
+    event.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &event);
+    conn->write_armed = false;
+}
+
+// Everything queued so far has been written to the socket
+static void onOutputDrained(Connection* conn, ServerConfig* config, int epollFd) {
+    conn->write_len = 0;
+    conn->write_pos = 0;
+    releaseWriteMap(conn);
+
+    if (conn->response_streaming) {
+        // A streaming response is still being produced: let the producer continue
+        disarmWrite(conn, epollFd);
+        ResponseDrainFn on_drain = conn->on_drain;
+        void* ctx = conn->drain_ctx;
+        conn->on_drain = NULL;
+        conn->drain_ctx = NULL;
+        if (on_drain) {
+            on_drain(conn, ctx, epollFd);
+        }
+        return;
+    }
+
+    if (conn->parsing_state != PARSE_STATE_SENDING) {
+        // Not a finished response (e.g. an interim one): the parser carries on
+        disarmWrite(conn, epollFd);
+        if (conn->read_deferred) {
+            handleConnection(conn, config, epollFd);
+        }
+        return;
+    }
+
+    // ============================================================
+    // All data sent successfully - THIS IS THE KEY DECISION POINT
+    // ============================================================
+    log_system(LOG_DEBUG, "Server: Finished writing all data to fd %d. keep_alive=%d", 
+               conn->fd, conn->request.keep_alive);
+    
+    // Check if we should keep the connection alive
+    if (conn->request.keep_alive) {
+        // === KEEP-ALIVE PATH ===
+        log_system(LOG_INFO, "Server: Keep-Alive enabled for fd %d, preparing for next request.", conn->fd);
+        
+        // Reset connection state for next request (compacts buffer, clears request struct)
+        resetConnectionForNextRequest(conn);
+        
+        // Unregister EPOLLOUT, keep listening for EPOLLIN
+        disarmWrite(conn, epollFd);
+        
+        // PIPELINE HANDLING: If there's already data in the buffer from the next request,
+        // we must process it now. In ET mode, if we don't, we might never get woken up
+        // because the "data arrival" edge already happened.
+        if (conn->read_len > 0 || conn->read_deferred) {
+            log_system(LOG_DEBUG, "Server: Pipeline detected! %zu bytes in buffer, processing next request.", conn->read_len);
+            conn->read_deferred = false;
+            handleConnection(conn, config, epollFd);
+        }
+    } else {
+        // === CLOSE PATH ===
+        log_system(LOG_DEBUG, "Server: Connection: close for fd %d, closing.", conn->fd);
+        discardPendingInput(conn);
+        closeConnection(conn, epollFd);
+    }
+}
+
 static void handleWrite(Connection* conn, ServerConfig* config, int epollFd) {
-    if (conn->write_len == 0) {
-        // Nothing to write, weird. Unregister interest in EPOLLOUT.
+    size_t buffered = conn->write_len - conn->write_pos;
+    size_t mapped = conn->write_map ? conn->write_map_end - conn->write_map_pos : 0;
+    if (buffered + mapped == 0) {
+        // Nothing left to write, e.g. the empty final write of a close-delimited stream
         log_system(LOG_DEBUG, "Server: handleWrite called on fd %d with empty write buffer.", conn->fd);
-        struct epoll_event event;
-        event.data.ptr = conn;
-        event.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
-        epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &event);
+        onOutputDrained(conn, config, epollFd);
         return;
     }
 
-    ssize_t nwritten = write(conn->fd, conn->write_buf + conn->write_pos, conn->write_len - conn->write_pos);
+    ssize_t nwritten;
+    if (mapped == 0) {
+        nwritten = write(conn->fd, conn->write_buf + conn->write_pos, buffered);
+    } else {
+        // The buffered head and the borrowed file slice go out in one call
+        struct iovec iov[2];
+        int iovcnt = 0;
+        if (buffered > 0) {
+            iov[iovcnt].iov_base = conn->write_buf + conn->write_pos;
+            iov[iovcnt++].iov_len = buffered;
+        }
+        iov[iovcnt].iov_base = (char*)file_cache_data(conn->write_map) + conn->write_map_pos;
+        iov[iovcnt++].iov_len = mapped;
+        nwritten = writev(conn->fd, iov, iovcnt);
+    }
     log_system(LOG_DEBUG, "Server: Wrote %zd bytes to fd %d", nwritten, conn->fd);
 
     if (nwritten > 0) {
-        conn->write_pos += nwritten;
-        if (conn->write_pos == conn->write_len) {
-            // ============================================================
-            // All data sent successfully - THIS IS THE KEY DECISION POINT
-            // ============================================================
-            log_system(LOG_DEBUG, "Server: Finished writing all data to fd %d. keep_alive=%d", 
-                       conn->fd, conn->request.keep_alive);
-            
-            // Check if we should keep the connection alive
-            if (conn->request.keep_alive) {
-                // === KEEP-ALIVE PATH ===
-                log_system(LOG_INFO, "Server: Keep-Alive enabled for fd %d, preparing for next request.", conn->fd);
-                
-                // Reset connection state for next request (compacts buffer, clears request struct)
-                resetConnectionForNextRequest(conn);
-                
-                // Unregister EPOLLOUT, keep listening for EPOLLIN
-                struct epoll_event event;
-                event.data.ptr = conn;
-                event.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
-                epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &event);
-                
-                // PIPELINE HANDLING: If there's already data in the buffer from the next request,
-                // we must process it now. In ET mode, if we don't, we might never get woken up
-                // because the "data arrival" edge already happened.
-                if (conn->read_len > 0) {
-                    log_system(LOG_DEBUG, "Server: Pipeline detected! %zu bytes in buffer, processing next request.", conn->read_len);
-                    handleConnection(conn, config, epollFd);
-                }
-            } else {
-                // === CLOSE PATH ===
-                log_system(LOG_DEBUG, "Server: Connection: close for fd %d, closing.", conn->fd);
-                closeConnection(conn, epollFd);
-            }
+        size_t from_buffer = (size_t)nwritten < buffered ? (size_t)nwritten : buffered;
+        conn->write_pos += from_buffer;
+        conn->write_map_pos += (size_t)nwritten - from_buffer;
+        if ((size_t)nwritten == buffered + mapped) {
+            onOutputDrained(conn, config, epollFd);
         }
         // If not all data was sent, we do nothing and wait for the next EPOLLOUT
     } else {
@@ -284,52 +550,431 @@ static void handleWrite(Connection* conn, ServerConfig* config, int epollFd) {
     }
 }
 
-void queue_data_for_writing(struct Connection* conn, const char* data, size_t len, int epollFd) {
+char* queue_reserve_for_writing(struct Connection* conn, size_t len) {
+    // A streaming response appends while earlier parts are being sent: reuse the sent space first
+    if (conn->write_pos > 0 && conn->write_len + len > conn->write_buf_size) {
+        conn->write_len -= conn->write_pos;
+        memmove(conn->write_buf, conn->write_buf + conn->write_pos, conn->write_len);
+        conn->write_pos = 0;
+    }
+
     // Check if buffer needs to be expanded
     if (conn->write_len + len > conn->write_buf_size) {
         size_t new_size = conn->write_buf_size;
         while (conn->write_len + len > new_size) {
             new_size *= 2;
         }
-        conn->write_buf = (char*)realloc(conn->write_buf, new_size);
+        char* new_buf = (char*)realloc(conn->write_buf, new_size);
+        if (!new_buf) {
+            log_system_rl(LOG_ERROR, "Server: Out of memory growing write buffer of fd %d to %zu bytes.", conn->fd, new_size);
+            return NULL;
+        }
+        conn->write_buf = new_buf;
         conn->write_buf_size = new_size;
     }
+    return conn->write_buf + conn->write_len;
+}
 
-    // Append new data to the write buffer
-    memcpy(conn->write_buf + conn->write_len, data, len);
+void queue_commit_for_writing(struct Connection* conn, size_t skip, size_t len, int epollFd) {
+    if (skip > 0) {
+        if (conn->write_pos == conn->write_len) {
+            // Nothing pending: let the queue start at the data
+            conn->write_len += skip;
+            conn->write_pos = conn->write_len;
+        } else {
+            memmove(conn->write_buf + conn->write_len, conn->write_buf + conn->write_len + skip, len);
+        }
+    }
     conn->write_len += len;
     log_system(LOG_DEBUG, "Server: Queued %zu bytes for writing to fd %d (total_queued=%zu)", len, conn->fd, conn->write_len);
 
-    // Register interest in EPOLLOUT to start sending
-    struct epoll_event event;
-    event.data.ptr = conn;
-    event.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP;
-    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &event);
+    // Register interest in EPOLLOUT to start sending (once per response part, not per call)
+    if (!conn->write_armed) {
+        struct epoll_event event;
+        event.data.ptr = conn;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &event);
+        conn->write_armed = true;
+    }
 }
 
-static void handleConnection(Connection* conn, ServerConfig* config, int epollFd) {
-    // 1. Read data from socket into connection buffer
-    char temp_buf[4096];
-    ssize_t bytesRead;
-    size_t total_bytes_read_this_call = 0;
-    // need space to add '\0'
-    while ((bytesRead = read(conn->fd, temp_buf, sizeof(temp_buf))) > 0) {
-        if (conn->read_len + bytesRead >= conn->read_buf_size) {
-            conn->read_buf_size *= 2;
-            conn->read_buf = (char*)realloc(conn->read_buf, conn->read_buf_size);
-        }
-        memcpy(conn->read_buf + conn->read_len, temp_buf, bytesRead);
-        conn->read_len += bytesRead;
-        total_bytes_read_this_call += bytesRead;
-    }
-    log_system(LOG_DEBUG, "Server: Read %zu bytes from fd %d. Total buffer size is now %zu.", total_bytes_read_this_call, conn->fd, conn->read_len);
-
-    if (bytesRead == 0 || (bytesRead < 0 && errno != EAGAIN)) {
-        log_system(LOG_DEBUG, "Server: Connection closed by peer or read error on fd %d.", conn->fd);
-        closeConnection(conn, epollFd);
+void queue_mapping_for_writing(struct Connection* conn, struct FileMapping* map, size_t offset, size_t len, int epollFd) {
+    releaseWriteMap(conn);
+    conn->write_map = map;
+    conn->write_map_pos = offset;
+    conn->write_map_end = offset + len;
+    log_system(LOG_DEBUG, "Server: Queued %zu mapped bytes for writing to fd %d", len, conn->fd);
+    if (!conn->write_armed) {
+        struct epoll_event event;
+        event.data.ptr = conn;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLRDHUP;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &event);
+        conn->write_armed = true;
+    }
+}
+
+void queue_data_for_writing(struct Connection* conn, const char* data, size_t len, int epollFd) {
+    char* space = queue_reserve_for_writing(conn, len);
+    if (!space) {
         return;
     }
+    // Append new data to the write buffer
+    if (len > 0) {
+        memcpy(space, data, len);
+    }
+    queue_commit_for_writing(conn, 0, len, epollFd);
+}
+
+// Answers the current request with an error before (all of) its body was read.
+// The unread rest of the body makes the connection unusable for another request.
+static void rejectRequest(Connection* conn, int status, int epollFd) {
+    log_system_rl(LOG_INFO, "Server: [%s] %s rejected with %d.",
+                  conn->request.method ? conn->request.method : "-",
+                  conn->request.uri ? conn->request.uri : "-", status);
+    conn->request.keep_alive = false;
+    conn->parsing_state = PARSE_STATE_SENDING;
 
+    HttpResponse res;
+    http_response_init(&res, status);
+    if (status == 401) {
+        http_response_set_header(&res, "WWW-Authenticate", "Bearer");
+    }
+    http_response_set_content_type(&res, "text/plain; charset=utf-8");
+    http_response_set_body_str(&res, res.status_text);
+    http_response_send(conn, &res, epollFd);
+    http_response_free(&res);
+}
+
+// Completion of the route's auth check: reject the request, or let parsing continue.
+static void onRouteAuthenticated(Connection* conn, ServerConfig* config, int epollFd, char* username) {
+    const Route* route = conn->request.route;
+    int status = 0;
+    if (!username) {
+        status = 401;
+    } else if (!auth_has_role(&conn->request, route->options.roles)) {
+        status = 403;
+    }
+
+    if (status) {
+        free(username);
+        rejectRequest(conn, status, epollFd);
+        return;
+    }
+
+    conn->request.authed_user = arena_strdup(&conn->request.arena, username);
+    free(username);
+    if (!conn->in_middleware) {
+        // Verified on the worker pool: resume where parsing stopped
+        handleConnection(conn, config, epollFd);
+    }
+}
+
+// Route middleware (see RouteOptions), run as soon as the headers are complete
+// so oversized or unauthenticated requests are rejected before their body is received.
+// Returns true if parsing may continue now; false if the request was rejected
+// or waits for an asynchronous token check.
+static bool runRouteMiddleware(Connection* conn, ServerConfig* config, int epollFd) {
+    const Route* route = router_find_route(conn->request.method, conn->request.uri);
+    conn->request.route = route;
+
+    // Chunked bodies have no length up front; decodeBody() enforces the limit as they arrive
+    size_t max_body = bodyLimit(conn, config);
+    if (max_body && conn->request.content_length > max_body) {
+        rejectRequest(conn, 413, epollFd);
+        return false;
+    }
+
+    if (!route || !route->options.auth_required) {
+        return true;
+    }
+
+    conn->in_middleware = true;
+    authenticate_request_async(conn, config, epollFd, onRouteAuthenticated);
+    conn->in_middleware = false;
+    return conn->async_pending == 0 && conn->parsing_state != PARSE_STATE_SENDING;
+}
+
+typedef enum {
+    READ_AGAIN,  // Socket drained
+    READ_LIMIT,  // Stopped at the limit, the socket may hold more
+    READ_CLOSED  // EOF or error
+} ReadResult;
+
+// The most bytes read_buf may hold in the current parse state. Bounding what is
+// read (rather than how much the peer sends) keeps memory per connection fixed.
+static size_t readLimit(const Connection* conn) {
+    switch (conn->parsing_state) {
+        case PARSE_STATE_REQ_LINE:
+        case PARSE_STATE_HEADERS:
+            return MAX_HEADER_SIZE; // The request starts at offset 0
+        case PARSE_STATE_BODY:
+            if (isStreamingRoute(conn->request.route) || conn->request.body_spilled) {
+                return conn->request.body_start + STREAM_BUFFER_SIZE;
+            }
+            if (conn->request.chunked) {
+                return conn->parsed_offset + STREAM_BUFFER_SIZE; // Decoded size is checked separately
+            }
+            return conn->parsed_offset + conn->request.content_length;
+        default:
+            return conn->parsed_offset + MAX_HEADER_SIZE; // Pipelined next request
+    }
+}
+
+// Reads straight into read_buf up to `limit` bytes. read_buf stays NUL-terminated
+// (read_len < read_buf_size), which the string-based parsing below relies on.
+static ReadResult readFromSocket(Connection* conn, size_t limit) {
+    size_t total = 0;
+    ReadResult result = READ_LIMIT;
+    while (conn->read_len < limit) {
+        if (conn->read_len + 1 >= conn->read_buf_size) {
+            size_t new_size = conn->read_buf_size * 2;
+            // Room for the NUL and the in-situ JSON padding behind a body that ends at limit
+            if (new_size > limit + 1 + YYJSON_PADDING_SIZE) new_size = limit + 1 + YYJSON_PADDING_SIZE;
+            char* new_buf = (char*)realloc(conn->read_buf, new_size);
+            if (!new_buf) {
+                log_system(LOG_ERROR, "Server: Failed to grow read buffer of fd %d to %zu bytes.", conn->fd, new_size);
+                result = READ_CLOSED; // The old buffer is kept and freed with the connection
+                break;
+            }
+            conn->read_buf = new_buf;
+            conn->read_buf_size = new_size;
+        }
+        size_t room = conn->read_buf_size - 1 - conn->read_len;
+        if (room > limit - conn->read_len) room = limit - conn->read_len;
+
+        ssize_t n = read(conn->fd, conn->read_buf + conn->read_len, room);
+        if (n > 0) {
+            conn->read_len += n;
+            total += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            result = (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) ? READ_AGAIN : READ_CLOSED;
+            break;
+        }
+    }
+    conn->read_buf[conn->read_len] = '\0';
+    log_system(LOG_DEBUG, "Server: Read %zu bytes from fd %d. Total buffer size is now %zu.", total, conn->fd, conn->read_len);
+    return result;
+}
+
+static bool parseRequest(Connection* conn, ServerConfig* config, int epollFd);
+
+static void handleConnection(Connection* conn, ServerConfig* config, int epollFd) {
+    conn->read_deferred = false;
+    while (1) {
+        if (conn->async_pending > 0) {
+            // The current request is still in use by a worker job; growing read_buf
+            // would move its body. Read once the response is out (see handleWrite).
+            conn->read_deferred = true;
+            return;
+        }
+
+        // 1. Read data from socket into connection buffer
+        ReadResult result = readFromSocket(conn, readLimit(conn));
+        if (result == READ_CLOSED) {
+            log_system(LOG_DEBUG, "Server: Connection closed by peer or read error on fd %d.", conn->fd);
+            closeConnection(conn, epollFd);
+            return;
+        }
+
+        // 2. Parse what we have; false means the connection is gone or waits for async work
+        ParsingState state = conn->parsing_state;
+        size_t offset = conn->parsed_offset;
+        size_t received = conn->request.body_received;
+        size_t buffered = conn->read_len;
+        if (!parseRequest(conn, config, epollFd)) {
+            return;
+        }
+        if (result == READ_AGAIN) {
+            return; // Edge-triggered: the next EPOLLIN brings more
+        }
+        if (state == conn->parsing_state && offset == conn->parsed_offset &&
+            received == conn->request.body_received && buffered == conn->read_len) {
+            // Buffer full and nothing consumed: a stream handler applies backpressure,
+            // or the next request waits for the current response. Leave the rest in
+            // the socket until server_resume_reading() / handleWrite() comes back.
+            conn->read_deferred = true;
+            return;
+        }
+    }
+}
+
+void server_resume_reading(struct Connection* conn, ServerConfig* config, int epollFd) {
+    if (!conn->closed) {
+        handleConnection(conn, config, epollFd);
+    }
+}
+
+// Validates the JSON body against the route's schema. On failure the 400 is
+// already queued and the handler must not run.
+static bool checkJsonSchema(Connection* conn, const Route* route, int epollFd) {
+    yyjson_val* root = http_get_json_root(&conn->request);
+    if (!root) {
+        http_send_json_error(conn, epollFd);
+        return false;
+    }
+    char err[256];
+    if (json_schema_validate(route->schema, root, err, sizeof(err)) == 0) {
+        return true;
+    }
+    log_system_rl(LOG_INFO, "Parser (fd=%d): Body rejected by schema of %s: %s", conn->fd, route->path, err);
+
+    // The message may quote payload keys, so let yyjson do the escaping
+    yyjson_mut_doc* doc = yyjson_mut_doc_new(arena_yyjson_alc(&conn->request.arena));
+    yyjson_mut_val* obj = doc ? yyjson_mut_obj(doc) : NULL;
+    if (!obj) {
+        http_send_error(conn, 400, "Bad Request", epollFd);
+        return false;
+    }
+    yyjson_mut_doc_set_root(doc, obj);
+    yyjson_mut_obj_add_str(doc, obj, "error", "Invalid request body");
+    yyjson_mut_obj_add_str(doc, obj, "message", err);
+    http_send_json_doc(conn, 400, doc, epollFd);
+    return false;
+}
+
+static bool bodyDecoded(const HttpRequest* req) {
+    return req->chunked ? req->chunk_state == CHUNK_STATE_DONE : req->body_received == req->content_length;
+}
+
+// Turns the raw body bytes after parsed_offset into body bytes at body_start + body_pending.
+// For chunked requests the framing is removed in place and the gap it leaves is closed,
+// so decoded data and the unparsed rest stay contiguous. Returns false if it rejected the request.
+static bool decodeBody(Connection* conn, ServerConfig* config, int epollFd) {
+    HttpRequest* req = &conn->request;
+    size_t out = req->body_start + req->body_pending;
+    size_t decoded;
+
+    if (req->chunked) {
+        if (http_chunked_decode(req, conn->read_buf, conn->read_len, &conn->parsed_offset, &out) < 0) {
+            log_system_rl(LOG_WARNING, "Parser (fd=%d): Malformed chunked body.", conn->fd);
+            rejectRequest(conn, 400, epollFd);
+            return false;
+        }
+        decoded = out - (req->body_start + req->body_pending);
+        if (out < conn->parsed_offset) {
+            size_t rest = conn->read_len - conn->parsed_offset;
+            memmove(conn->read_buf + out, conn->read_buf + conn->parsed_offset, rest);
+            conn->read_len = out + rest;
+            conn->read_buf[conn->read_len] = '\0';
+            conn->parsed_offset = out;
+        }
+    } else {
+        // Content-Length body (streaming routes): nothing to decode
+        decoded = conn->read_len - conn->parsed_offset;
+        if (decoded > req->content_length - req->body_received) {
+            decoded = req->content_length - req->body_received;
+        }
+        conn->parsed_offset += decoded;
+    }
+    req->body_pending += decoded;
+    req->body_received += decoded;
+
+    size_t limit = bodyLimit(conn, config);
+    if (limit && req->body_received > limit) {
+        rejectRequest(conn, 413, epollFd);
+        return false;
+    }
+    return true;
+}
+
+// Drops body bytes before body_start that were handed on, so the buffer never holds
+// more than STREAM_BUFFER_SIZE of them (the request line and headers were copied out,
+// nothing points into it)
+static void dropConsumedBody(Connection* conn) {
+    HttpRequest* req = &conn->request;
+    if (req->body_start > 0) {
+        size_t drop = req->body_start;
+        conn->read_len -= drop;
+        memmove(conn->read_buf, conn->read_buf + drop, conn->read_len);
+        conn->read_buf[conn->read_len] = '\0';
+        conn->parsed_offset -= drop;
+        req->body_start = 0;
+    }
+}
+
+// Hands decoded body bytes to the stream handler. Returns false if it aborted the request.
+static bool deliverBody(Connection* conn, int epollFd) {
+    HttpRequest* req = &conn->request;
+    const Route* route = req->route;
+
+    while (req->body_pending > 0) {
+        long n = route->stream.on_body_chunk(conn, conn->read_buf + req->body_start, req->body_pending);
+        if (n < 0) {
+            int status = (int)-n;
+            rejectRequest(conn, (status >= 400 && status <= 599) ? status : 500, epollFd);
+            return false;
+        }
+        if (n == 0) break; // Backpressure
+        if ((size_t)n > req->body_pending) n = (long)req->body_pending;
+        req->body_start += n;
+        req->body_pending -= n;
+    }
+
+    dropConsumedBody(conn);
+    return true;
+}
+
+// Keeps a buffered body in memory while it fits the threshold and the global budget,
+// otherwise switches it to a temp file. Returns false if it rejected the request.
+static bool reserveBodyMemory(Connection* conn, int epollFd) {
+    HttpRequest* req = &conn->request;
+    if (req->body_spilled) {
+        return true;
+    }
+    // Content-Length bodies are charged up front, chunked ones as they are decoded
+    size_t wanted = req->chunked ? req->body_received : req->content_length;
+    if (body_memory_reserve(req->body_mem_reserved, wanted)) {
+        if (wanted > req->body_mem_reserved) req->body_mem_reserved = wanted;
+        return true;
+    }
+
+    int fd = body_spill_open();
+    if (fd == -1) {
+        rejectRequest(conn, 503, epollFd);
+        return false;
+    }
+    log_system(LOG_DEBUG, "Parser (fd=%d): Spilling body of %s %s to disk.", conn->fd, req->method, req->uri);
+    body_memory_release(req->body_mem_reserved);
+    req->body_mem_reserved = 0;
+    req->body_spilled = true;
+    req->body_fd = fd;
+    return true;
+}
+
+// Writes decoded body bytes to the spill file. Returns false if it rejected the request.
+static bool spillBody(Connection* conn, int epollFd) {
+    HttpRequest* req = &conn->request;
+    if (req->body_pending > 0) {
+        if (body_spill_write(req->body_fd, conn->read_buf + req->body_start, req->body_pending) != 0) {
+            rejectRequest(conn, 500, epollFd);
+            return false;
+        }
+        req->body_start += req->body_pending;
+        req->body_pending = 0;
+    }
+    dropConsumedBody(conn);
+    return true;
+}
+
+// Strict Content-Length: digits only, no overflow. Returns -1 if malformed.
+static int parseContentLength(const char* value, size_t* out) {
+    size_t n = 0;
+    if (!*value) return -1;
+    for (const char* p = value; *p; p++) {
+        if (*p < '0' || *p > '9') return -1;
+        if (n > (SIZE_MAX - (size_t)(*p - '0')) / 10) return -1;
+        n = n * 10 + (size_t)(*p - '0');
+    }
+    *out = n;
+    return 0;
+}
+
+// Advances the parser over read_buf and runs the handler once a request is complete.
+// Returns false if the connection was closed, the request was rejected, or it now
+// waits for an asynchronous step; the caller must not touch conn then.
+static bool parseRequest(Connection* conn, ServerConfig* config, int epollFd) {
     // 2. Try to parse the request incrementally
     // All state is now in the conn struct, no local HttpRequest needed.
     
@@ -350,10 +995,11 @@ static void handleConnection(Connection* conn, ServerConfig* config, int epollFd
             // 注意：strtok_r 是具有破坏性的。它会把原字符串里的分隔符（空格）直接替换成 \0
             char* method_token = strtok_r(line_buf, " ", &saveptr);
             
-            // 2. strdup: 在堆(Heap)上申请内存并拷贝字符串。
+            // 2. arena_strdup: 拷贝到请求的 arena 中（见 arena.h）。
             // 必须拷贝，因为 line_buf 是栈上的局部变量，出了作用域就会失效。
-            // 注意：strdup 返回的指针后续需要 free。
-            conn->request.method = method_token ? strdup(method_token) : NULL;
+            // 不需要单独 free，请求结束时 arena 整体释放。
+            Arena* arena = &conn->request.arena;
+            conn->request.method = arena_strdup(arena, method_token);
             
             // 3. 第二次调用：传入 NULL，告诉函数“接着上次 saveptr 记录的位置继续切”，提取 URI。
             char* full_uri = strtok_r(NULL, " ", &saveptr);
@@ -378,13 +1024,25 @@ static void handleConnection(Connection* conn, ServerConfig* config, int epollFd
                 char* query_start = strchr(full_uri, '?');
                 if (query_start) {
                     *query_start = '\0'; // Split the string
-                    conn->request.raw_uri = strdup(full_uri);
-                    conn->request.uri = urlDecode(full_uri); // 堆分配，需要free
-                    conn->request.raw_query_string = strdup(query_start + 1);
-                    conn->request.query_string = urlDecode(query_start + 1);
+                }
+                size_t uri_len = strlen(full_uri);
+                conn->request.raw_uri = arena_strndup(arena, full_uri, uri_len);
+                conn->request.uri = arena_strndup(arena, full_uri, uri_len);
+                if (conn->request.uri) {
+                    urlDecodeInPlace(conn->request.uri, uri_len);
+                }
+                if (query_start) {
+                    // Twice the size: parse_params() splits a copy behind the raw query
+                    size_t query_len = strlen(query_start + 1);
+                    conn->request.raw_query_string = arena_alloc(arena, 2 * (query_len + 1));
+                    if (conn->request.raw_query_string) {
+                        memcpy(conn->request.raw_query_string, query_start + 1, query_len + 1);
+                    }
+                    conn->request.query_string = arena_strndup(arena, query_start + 1, query_len);
+                    if (conn->request.query_string) {
+                        urlDecodeInPlace(conn->request.query_string, query_len);
+                    }
                 } else {
-                    conn->request.raw_uri = strdup(full_uri);
-                    conn->request.uri = urlDecode(full_uri);
                     conn->request.raw_query_string = NULL;
                     conn->request.query_string = NULL;
                 }
@@ -393,15 +1051,19 @@ static void handleConnection(Connection* conn, ServerConfig* config, int epollFd
                 conn->parsing_state = PARSE_STATE_HEADERS;
                 conn->parsed_offset += line_len + 2; // +2 for \r\n
             } else { // Malformed
-                 log_system(LOG_WARNING, "Parser (fd=%d): Malformed request line.", conn->fd);
-                 free(conn->request.method);
-                 // error handling...
+                 log_system_rl(LOG_WARNING, "Parser (fd=%d): Malformed request line.", conn->fd);
+                 conn->request.method = NULL;
                  closeConnection(conn, epollFd);
+                 return false;
             }
         }
     }
 
     // State: PARSE_HEADERS
+    bool headers_completed = false;
+    bool bad_header = false;
+    bool unsupported_coding = false;
+    bool unsupported_expect = false;
     if (conn->parsing_state == PARSE_STATE_HEADERS) {
         char* start = conn->read_buf + conn->parsed_offset;
         char* end = conn->read_buf + conn->read_len;
@@ -414,7 +1076,9 @@ static void handleConnection(Connection* conn, ServerConfig* config, int epollFd
             if (line_end == start) { // Empty line, marks end of headers
                 conn->parsed_offset = (line_end - conn->read_buf) + 2;
                 log_system(LOG_DEBUG, "Parser (fd=%d): Finished parsing headers. Content-Length=%zu", conn->fd, conn->request.content_length);
-                conn->parsing_state = (conn->request.content_length > 0) ? PARSE_STATE_BODY : PARSE_STATE_COMPLETE;
+                conn->request.body_start = conn->parsed_offset;
+                conn->parsing_state = (conn->request.content_length > 0 || conn->request.chunked) ? PARSE_STATE_BODY : PARSE_STATE_COMPLETE;
+                headers_completed = true;
                 break; // <-- THE FIX: Exit header parsing loop
             }
 
@@ -423,22 +1087,44 @@ static void handleConnection(Connection* conn, ServerConfig* config, int epollFd
                 // Only store header if we have space
                 if (conn->request.header_count < MAX_HEADERS) {
                     // Parse Key
-                    char key_buf[colon - start + 1];
-                    memcpy(key_buf, start, colon - start);
-                    key_buf[colon - start] = '\0';
-                    conn->request.headers[conn->request.header_count].key = strdup(key_buf);
+                    char* key_buf = arena_strndup(&conn->request.arena, start, colon - start);
 
                     // Parse Value
                     char* value_start = colon + 1;
                     while (*value_start == ' ') value_start++; // Trim leading spaces
-                    char value_buf[line_end - value_start + 1];
-                    memcpy(value_buf, value_start, line_end - value_start);
-                    value_buf[line_end - value_start] = '\0';
-                    conn->request.headers[conn->request.header_count].value = strdup(value_buf);
+                    char* value_buf = arena_strndup(&conn->request.arena, value_start, line_end - value_start);
+                    if (!key_buf || !value_buf) {
+                        closeConnection(conn, epollFd);
+                        return false;
+                    }
+                    conn->request.headers[conn->request.header_count].key = key_buf;
+                    conn->request.headers[conn->request.header_count].value = value_buf;
                     log_system(LOG_DEBUG, "Parser (fd=%d): Parsed header: %s: %s", conn->fd, key_buf, value_buf);
 
                     if (strcasecmp(key_buf, "Content-Length") == 0) {
-                        conn->request.content_length = atol(value_buf);
+                        // A malformed or conflicting length would desync request framing
+                        size_t length = 0;
+                        if (parseContentLength(value_buf, &length) != 0 ||
+                            (conn->request.has_content_length && length != conn->request.content_length)) {
+                            bad_header = true;
+                        }
+                        conn->request.content_length = length;
+                        conn->request.has_content_length = true;
+                    }
+                    else if (strcasecmp(key_buf, "Expect") == 0) {
+                        if (strcasecmp(value_buf, "100-continue") == 0) {
+                            conn->request.expect_continue = true;
+                        } else {
+                            unsupported_expect = true;
+                        }
+                    }
+                    else if (strcasecmp(key_buf, "Transfer-Encoding") == 0) {
+                        // Only plain "chunked" is decoded; other codings are refused below
+                        if (strcasecmp(value_buf, "chunked") == 0 && !conn->request.chunked) {
+                            conn->request.chunked = true;
+                        } else {
+                            unsupported_coding = true;
+                        }
                     }
                     // Check for Connection header to override default keep-alive
                     else if (strcasecmp(key_buf, "Connection") == 0) {
@@ -452,7 +1138,7 @@ static void handleConnection(Connection* conn, ServerConfig* config, int epollFd
                     }
                     conn->request.header_count++;
                 } else {
-                    log_system(LOG_WARNING, "Parser (fd=%d): Max headers reached, ignoring header.", conn->fd);
+                    log_system_rl(LOG_WARNING, "Parser (fd=%d): Max headers reached, ignoring header.", conn->fd);
                     // We still parse Content-Length even if we don't store the header, strictly speaking
                     // But for simplicity, we just ignore everything else.
                 }
@@ -462,10 +1148,89 @@ static void handleConnection(Connection* conn, ServerConfig* config, int epollFd
         }
     }
 
+    if (headers_completed && conn->request.chunked && conn->request.has_content_length) {
+        bad_header = true; // Ambiguous framing (request smuggling), RFC 9112 6.3
+    }
+    if (bad_header) {
+        log_system_rl(LOG_WARNING, "Parser (fd=%d): Invalid Content-Length / Transfer-Encoding.", conn->fd);
+        rejectRequest(conn, 400, epollFd);
+        return false;
+    }
+    if (unsupported_coding) {
+        rejectRequest(conn, 501, epollFd);
+        return false;
+    }
+    if (unsupported_expect) {
+        rejectRequest(conn, 417, epollFd);
+        return false;
+    }
+    if ((conn->parsing_state == PARSE_STATE_REQ_LINE || conn->parsing_state == PARSE_STATE_HEADERS) &&
+        conn->read_len >= MAX_HEADER_SIZE) {
+        rejectRequest(conn, 431, epollFd);
+        return false;
+    }
+
+    // Route middleware runs once per request, before any of the body is consumed
+    if (headers_completed && !runRouteMiddleware(conn, config, epollFd)) {
+        return false;
+    }
+
+    // Stream handlers see the request once it passed the middleware, before its body
+    const Route* route = conn->request.route;
+    if (isStreamingRoute(route) && !conn->request.stream_started &&
+        (conn->parsing_state == PARSE_STATE_BODY || conn->parsing_state == PARSE_STATE_COMPLETE)) {
+        int status = route->stream.on_headers ? route->stream.on_headers(conn, config, epollFd) : 0;
+        if (status) {
+            rejectRequest(conn, status, epollFd);
+            return false;
+        }
+        conn->request.stream_started = true;
+    }
+
+    // The client holds the body back until we agree. Every check that can reject the
+    // request from its headers alone (size, auth, roles, stream handler) has passed by
+    // now and answered with a final status otherwise, so an upload we refuse is never sent.
+    if (conn->request.expect_continue && conn->parsing_state == PARSE_STATE_BODY) {
+        conn->request.expect_continue = false;
+        if (conn->request.minor_version >= 1 && conn->read_len == conn->parsed_offset) {
+            static const char CONTINUE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+            queue_data_for_writing(conn, CONTINUE, sizeof(CONTINUE) - 1, epollFd);
+        }
+    }
+
     // Use a direct check instead of goto to simplify flow
-    if (conn->parsing_state == PARSE_STATE_BODY) {
-        // Here we would handle reading the request body.
-        // For now, we will assume body is fully read if content_length is met
+    bool streaming = isStreamingRoute(route);
+    if (conn->parsing_state == PARSE_STATE_BODY && !streaming && !conn->request.chunked &&
+        !reserveBodyMemory(conn, epollFd)) {
+        return false;
+    }
+    if (conn->parsing_state == PARSE_STATE_BODY &&
+        (conn->request.chunked || streaming || conn->request.body_spilled)) {
+        if (!decodeBody(conn, config, epollFd)) {
+            return false;
+        }
+        if (!streaming && conn->request.chunked && !reserveBodyMemory(conn, epollFd)) {
+            return false;
+        }
+        if (streaming ? !deliverBody(conn, epollFd)
+                      : (conn->request.body_spilled && !spillBody(conn, epollFd))) {
+            return false;
+        }
+        if (bodyDecoded(&conn->request) && (conn->request.body_pending == 0 || !(streaming || conn->request.body_spilled))) {
+            conn->request.content_length = conn->request.body_received;
+            if (conn->request.body_spilled) {
+                conn->request.body = body_spill_map(conn->request.body_fd, conn->request.content_length);
+                if (!conn->request.body) {
+                    rejectRequest(conn, 500, epollFd);
+                    return false;
+                }
+            } else if (!streaming) {
+                // Decoded chunked body, it ends at parsed_offset like a Content-Length one
+                conn->request.body = conn->read_buf + conn->request.body_start;
+            }
+            conn->parsing_state = PARSE_STATE_COMPLETE;
+        }
+    } else if (conn->parsing_state == PARSE_STATE_BODY) {
         log_system(LOG_DEBUG, "Parser (fd=%d): In body parsing state. Buffer has %zu bytes, need %zu for body.", conn->fd, conn->read_len - conn->parsed_offset, conn->request.content_length);
         if (conn->read_len >= conn->parsed_offset + conn->request.content_length) {
             conn->request.body = conn->read_buf + conn->parsed_offset;
@@ -499,26 +1264,32 @@ static void handleConnection(Connection* conn, ServerConfig* config, int epollFd
             // There is data after the body (the next request), save it!
             saved_char = conn->read_buf[body_end_idx];
             need_restore = true;
-        } else {
-            // No next request data yet. 
-            // Ensure we don't write OOB. In practice, our buffer growth strategy (doubling) 
-            // usually leaves space. Strictly we should check capacity, but for now assuming safety.
-            // If read_len == capacity, we might need a spare byte. 
         }
+        // Otherwise body_end_idx == read_len, and readFromSocket() keeps that byte in bounds
         
         // Temporarily null-terminate
         // Note: conn->request.body[content_length] is exactly conn->read_buf[body_end_idx]
         conn->read_buf[body_end_idx] = '\0';
+        if (conn->request.body_spilled) {
+            conn->request.body_padding = BODY_SPILL_PADDING;
+        } else if (conn->request.body) {
+            // Past the NUL, only bytes no pipelined request occupies are free
+            conn->request.body_padding = need_restore ? 1 : conn->read_buf_size - body_end_idx;
+        }
         
-        // Pre-parse all parameters (Phase 2)
-        http_parse_all_params(&conn->request);
-        
+        // Parameters and the JSON body are parsed on first access (utils.h)
+
         // --- Routing Logic ---
-        RouteHandler handler = router_find_handler(conn->request.method, conn->request.uri);
-        if (handler) {
+        RouteHandler handler = route ? route->handler : NULL;
+        if (isStreamingRoute(route)) {
+            conn->request.stream_started = false;
+            route->stream.on_complete(conn, config, epollFd);
+        } else if (handler) {
             // Found a matching API handler
-            log_system(LOG_DEBUG, "Routing to API handler for %s %s", conn->request.method, conn->request.uri);
-            handler(conn, config, epollFd);
+            if (!route->schema || checkJsonSchema(conn, route, epollFd)) {
+                log_system(LOG_DEBUG, "Routing to API handler for %s %s", conn->request.method, conn->request.uri);
+                handler(conn, config, epollFd);
+            }
         } else {
             // No API handler found, fall back to static file serving
             handleStaticRequest(conn, config, epollFd);
@@ -526,7 +1297,13 @@ static void handleConnection(Connection* conn, ServerConfig* config, int epollFd
         
         // --- RESTORE ---
         if (need_restore) {
-            conn->read_buf[body_end_idx] = saved_char;
+            if (conn->async_pending > 0) {
+                // The handler finishes later and may still read the body
+                conn->body_saved_char = saved_char;
+                conn->body_restore = true;
+            } else {
+                conn->read_buf[body_end_idx] = saved_char;
+            }
         }
         
         // CRITICAL: Transition to SENDING state to prevent re-entry
@@ -535,4 +1312,5 @@ static void handleConnection(Connection* conn, ServerConfig* config, int epollFd
         conn->parsing_state = PARSE_STATE_SENDING;
         log_system(LOG_DEBUG, "Parser (fd=%d): State -> SENDING. Waiting for response to complete.", conn->fd);
     }
+    return true;
 } 
\ No newline at end of file
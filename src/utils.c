@@ -7,6 +7,13 @@
 #include <errno.h> // Required for errno
 #include <unistd.h> // Required for write
 #include "logger.h" // Include logger for debug messages
+#include "multipart.h"
+#include "mime.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 static int hex_to_int(char c) {
     if (c >= '0' && c <= '9') return c - '0';
@@ -21,93 +28,107 @@ char* urlDecode(const char* str) {
     size_t len = strlen(str);
     char* decoded = (char*)malloc(len + 1);
     if (!decoded) return NULL;
-
-    size_t decoded_len = 0;
-    for (size_t i = 0; i < len; i++) {
-        if (str[i] == '+') {
-            decoded[decoded_len++] = ' ';
-        } else if (str[i] == '%' && i + 2 < len) {
-            int hi = hex_to_int(str[i + 1]);
-            int lo = hex_to_int(str[i + 2]);
-            if (hi != -1 && lo != -1) {
-                decoded[decoded_len++] = (char)((hi << 4) | lo);
-                i += 2;
-            } else {
-                // Invalid hex sequence, copy as is
-                log_system(LOG_DEBUG, "Utils: Invalid hex sequence '%%%c%c' in urlDecode.", str[i+1], str[i+2]);
-                decoded[decoded_len++] = str[i];
-            }
-        } else {
-            decoded[decoded_len++] = str[i];
-        }
-    }
-    decoded[decoded_len] = '\0';
-
+    memcpy(decoded, str, len);
+    urlDecodeInPlace(decoded, len);
     return decoded;
 }
 
 const char* getMimeType(const char* path) {
-    const char* dot = strrchr(path, '.');
-    if (!dot) {
-        log_system(LOG_DEBUG, "Utils: No file extension found for '%s', defaulting to octet-stream.", path);
-        return "application/octet-stream";
-    }
-    if (strcmp(dot, ".html") == 0) {
-        return "text/html";
-    }
-    if (strcmp(dot, ".css") == 0) {
-        return "text/css";
-    }
-    if (strcmp(dot, ".js") == 0) {
-        return "application/javascript";
+    return mime_lookup(path)->type;
+}
+
+// Index of the first '%' or '+' in s[from, len), or len. Most URL bytes need
+// no decoding, so the scan runs 16 bytes at a time where the target has SIMD.
+static size_t find_escape(const char* s, size_t from, size_t len) {
+#if defined(__SSE2__)
+    const __m128i pct = _mm_set1_epi8('%');
+    const __m128i plus = _mm_set1_epi8('+');
+    for (; from + 16 <= len; from += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + from));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, pct), _mm_cmpeq_epi8(v, plus)));
+        if (mask) return from + __builtin_ctz(mask);
     }
-    if (strcmp(dot, ".jpg") == 0 || strcmp(dot, ".jpeg") == 0) {
-        return "image/jpeg";
+#elif defined(__ARM_NEON)
+    const uint8x16_t pct = vdupq_n_u8('%');
+    const uint8x16_t plus = vdupq_n_u8('+');
+    for (; from + 16 <= len; from += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)s + from);
+        uint8x16_t hit = vorrq_u8(vceqq_u8(v, pct), vceqq_u8(v, plus));
+        // Narrow to 4 bits per byte to get a scalar mask
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)), 0);
+        if (mask) return from + (__builtin_ctzll(mask) >> 2);
     }
-    if (strcmp(dot, ".png") == 0) {
-        return "image/png";
+#endif
+    while (from < len && s[from] != '%' && s[from] != '+') from++;
+    return from;
+}
+
+size_t urlDecodeInPlace(char* s, size_t len) {
+    // Nothing moves before the first escape, and clean spans after it move as a whole
+    size_t in = find_escape(s, 0, len);
+    size_t out = in;
+    while (in < len) {
+        int hi, lo;
+        if (s[in] == '+') {
+            s[out++] = ' ';
+            in++;
+        } else if (in + 2 < len && (hi = hex_to_int(s[in + 1])) != -1 && (lo = hex_to_int(s[in + 2])) != -1) {
+            s[out++] = (char)((hi << 4) | lo);
+            in += 3;
+        } else {
+            s[out++] = '%'; // Invalid escape, kept as is
+            in++;
+        }
+        size_t next = find_escape(s, in, len);
+        memmove(s + out, s + in, next - in);
+        out += next - in;
+        in = next;
     }
-    if (strcmp(dot, ".gif") == 0) {
-        return "image/gif";
+    s[out] = '\0';
+    return out;
+}
+
+// Compares an encoded slice with a plain key without decoding into a buffer
+static bool encoded_equals(const char* enc, size_t len, const char* key) {
+    if (find_escape(enc, 0, len) == len) {
+        return strncmp(enc, key, len) == 0 && key[len] == '\0';
     }
-    if (strcmp(dot, ".ico") == 0) {
-        return "image/x-icon";
+    size_t k = 0;
+    for (size_t i = 0; i < len; i++, k++) {
+        char c = enc[i];
+        if (c == '+') {
+            c = ' ';
+        } else if (c == '%' && i + 2 < len && hex_to_int(enc[i + 1]) != -1 && hex_to_int(enc[i + 2]) != -1) {
+            c = (char)((hex_to_int(enc[i + 1]) << 4) | hex_to_int(enc[i + 2]));
+            i += 2;
+        }
+        if (key[k] != c) return false;
     }
-    log_system(LOG_DEBUG, "Utils: Unknown file extension '%s' for path '%s', defaulting to octet-stream.", dot, path);
-    return "application/octet-stream"; // Default binary type
+    return key[k] == '\0';
 }
 
 char* get_query_param(const char* str, const char* key) {
     if (!str || !key) return NULL;
     log_system(LOG_DEBUG, "Utils: Parsing query string for key '%s'.", key);
-    // We duplicate the string because strtok_r modifies it.
-    char* str_copy = strdup(str);
-    if (!str_copy) return NULL;
-
-    char* value = NULL;
-    char* saveptr;
 
-    char* token = strtok_r(str_copy, "&", &saveptr);
-    while (token != NULL) {
-        char* eq = strchr(token, '=');
-        if (eq) {
-            *eq = '\0'; // Split key and value
-            char* decoded_key = urlDecode(token);
-            if (strcmp(decoded_key, key) == 0) {
-                // Key matches, decode the value and store it
-                char* decoded_value = urlDecode(eq + 1);
-                value = strdup(decoded_value);
-                log_system(LOG_DEBUG, "Utils: Found key '%s' with value '%s'.", key, value);
-                free(decoded_value);
-            }
-            free(decoded_key);
-            if (value) break; // Found, no need to continue
+    const char* p = str;
+    while (*p) {
+        size_t pair_len = strcspn(p, "&");
+        const char* eq = memchr(p, '=', pair_len);
+        if (eq && encoded_equals(p, eq - p, key)) {
+            // Only the returned value is allocated
+            size_t value_len = pair_len - (eq + 1 - p);
+            char* value = malloc(value_len + 1);
+            if (!value) return NULL;
+            memcpy(value, eq + 1, value_len);
+            urlDecodeInPlace(value, value_len);
+            log_system(LOG_DEBUG, "Utils: Found key '%s' with value '%s'.", key, value);
+            return value;
         }
-        token = strtok_r(NULL, "&", &saveptr);
+        p += pair_len;
+        if (*p == '&') p++;
     }
-
-    free(str_copy);
-    return value;
+    return NULL;
 }
 
 // ============================================================================
@@ -116,41 +137,36 @@ char* get_query_param(const char* str, const char* key) {
 
 #include "http.h"  // For HttpRequest, QueryParam
 #include <strings.h> // For strcasecmp
+#include <stdbool.h>
+
+int parse_params(char* str, size_t len, QueryParam* params, int max_params) {
+    if (!str || !params || max_params <= 0) return 0;
 
-int parse_params(const char* str, void* params_ptr, int max_params) {
-    if (!str || !params_ptr || max_params <= 0) return 0;
-    
-    QueryParam* params = (QueryParam*)params_ptr;
     int count = 0;
-    
-    // Duplicate the string because we'll modify it
-    char* str_copy = strdup(str);
-    if (!str_copy) return 0;
-    
-    char* saveptr;
-    char* token = strtok_r(str_copy, "&", &saveptr);
-    
-    while (token != NULL && count < max_params) {
-        char* eq = strchr(token, '=');
+    char* p = str;
+    char* end = str + len;
+    while (p < end && count < max_params) {
+        char* amp = memchr(p, '&', end - p);
+        char* pair_end = amp ? amp : end;
+        char* eq = memchr(p, '=', pair_end - p);
         if (eq) {
             *eq = '\0';
-            char* decoded_key = urlDecode(token);
-            char* decoded_value = urlDecode(eq + 1);
-            
-            if (decoded_key && decoded_value) {
-                params[count].key = decoded_key;
-                params[count].value = decoded_value;
-                count++;
-                log_system(LOG_DEBUG, "Utils: Parsed param[%d]: %s = %s", count - 1, decoded_key, decoded_value);
-            } else {
-                free(decoded_key);
-                free(decoded_value);
+            *pair_end = '\0'; // '&', or the terminator at str[len]
+            char* value = eq + 1;
+            // Most keys and values have nothing to decode
+            if (memchr(p, '%', eq - p) || memchr(p, '+', eq - p)) {
+                urlDecodeInPlace(p, eq - p);
+            }
+            if (memchr(value, '%', pair_end - value) || memchr(value, '+', pair_end - value)) {
+                urlDecodeInPlace(value, pair_end - value);
             }
+            params[count].key = p;
+            params[count].value = value;
+            count++;
+            log_system(LOG_DEBUG, "Utils: Parsed param[%d]: %s = %s", count - 1, p, value);
         }
-        token = strtok_r(NULL, "&", &saveptr);
+        p = pair_end + 1;
     }
-    
-    free(str_copy);
     return count;
 }
 
@@ -164,46 +180,80 @@ static const char* get_content_type(const HttpRequest* req) {
     return NULL;
 }
 
-void http_parse_all_params(HttpRequest* req) {
-    if (!req) return;
-    
-    // Parse query string parameters
-    if (req->raw_query_string && strlen(req->raw_query_string) > 0) {
-        req->query_param_count = parse_params(
-            req->raw_query_string, 
-            req->query_params, 
+// The parsers below run on first access, so requests only pay for what the handler reads
+
+static void ensure_query_params(HttpRequest* req) {
+    if (req->query_parsed) return;
+    req->query_parsed = true;
+    if (req->raw_query_string && req->raw_query_string[0] != '\0') {
+        // The parser allocated room for a second copy behind the raw query
+        size_t len = strlen(req->raw_query_string);
+        char* scratch = req->raw_query_string + len + 1;
+        memcpy(scratch, req->raw_query_string, len + 1);
+        req->query_param_count = parse_params(scratch, len, req->query_params, MAX_PARAMS);
+        log_system(LOG_DEBUG, "Utils: Parsed %d query parameters.", req->query_param_count);
+    }
+}
+
+static void ensure_body_params(HttpRequest* req) {
+    // Not latched before the body is complete (e.g. from a stream handler's on_headers)
+    if (req->body_parsed || !req->body) return;
+    req->body_parsed = true;
+    const char* content_type = get_content_type(req);
+    if (!content_type || req->content_length == 0) return;
+
+    if (strstr(content_type, "application/x-www-form-urlencoded")) {
+        // Parse form body parameters
+        req->body_param_count = parse_params(
+            req->body,
+            req->content_length,
+            req->body_params,
             MAX_PARAMS
         );
-        log_system(LOG_DEBUG, "Utils: Parsed %d query parameters.", req->query_param_count);
+        log_system(LOG_DEBUG, "Utils: Parsed %d body parameters (x-www-form-urlencoded).", req->body_param_count);
+    } else if (strstr(content_type, "multipart/form-data")) {
+        // Plain fields only; file parts are left to the handler (multipart.h)
+        multipart_collect_fields(req, content_type);
+        log_system(LOG_DEBUG, "Utils: Parsed %d body parameters (multipart/form-data).", req->body_param_count);
     }
-    
-    // Parse body based on Content-Type
-    if (req->body && req->content_length > 0) {
-        const char* content_type = get_content_type(req);
-        if (content_type) {
-            if (strstr(content_type, "application/x-www-form-urlencoded")) {
-                // Parse form body parameters
-                req->body_param_count = parse_params(
-                    req->body, 
-                    req->body_params, 
-                    MAX_PARAMS
-                );
-                log_system(LOG_DEBUG, "Utils: Parsed %d body parameters (x-www-form-urlencoded).", req->body_param_count);
-            } else if (strstr(content_type, "application/json")) {
-                // Phase 3: Parse JSON body
-                req->json_doc = yyjson_read(req->body, req->content_length, 0);
-                if (req->json_doc) {
-                    req->json_root = yyjson_doc_get_root(req->json_doc);
-                    log_system(LOG_DEBUG, "Utils: Parsed JSON body successfully.");
-                } else {
-                    log_system(LOG_WARNING, "Utils: Failed to parse JSON body.");
-                }
-            }
-        }
+}
+
+yyjson_val* http_get_json_root(HttpRequest* req) {
+    if (!req) return NULL;
+    if (req->json_parsed || !req->body) return req->json_root;
+    req->json_parsed = true;
+    const char* content_type = get_content_type(req);
+    if (!content_type || !strstr(content_type, "application/json") || req->content_length == 0) {
+        return NULL;
+    }
+
+    // Phase 3: Parse JSON body. Strings are unescaped in place in the body
+    // whenever the buffer has room for the reader's padding, so nothing is copied.
+    yyjson_read_flag flags = 0;
+    if (req->body_padding >= YYJSON_PADDING_SIZE) {
+        memset(req->body + req->content_length, 0, YYJSON_PADDING_SIZE);
+        flags |= YYJSON_READ_INSITU;
     }
+    req->json_doc = yyjson_read_opts(req->body, req->content_length, flags,
+                                     arena_yyjson_alc(&req->arena), &req->json_err);
+    if (req->json_doc) {
+        req->json_root = yyjson_doc_get_root(req->json_doc);
+        log_system(LOG_DEBUG, "Utils: Parsed JSON body successfully%s.", (flags & YYJSON_READ_INSITU) ? " (in situ)" : "");
+    } else {
+        log_system_rl(LOG_WARNING, "Utils: Failed to parse JSON body at byte %zu: %s",
+                      req->json_err.pos, req->json_err.msg);
+    }
+    return req->json_root;
+}
+
+void http_parse_all_params(HttpRequest* req) {
+    if (!req) return;
+    ensure_query_params(req);
+    ensure_body_params(req);
+    http_get_json_root(req);
 }
 
-const char* http_get_param(const HttpRequest* req, const char* key) {
+const char* http_get_param(HttpRequest* req, const char* key) {
     if (!req || !key) return NULL;
     
     // Search query params first
@@ -214,9 +264,10 @@ const char* http_get_param(const HttpRequest* req, const char* key) {
     return http_get_body_param(req, key);
 }
 
-const char* http_get_query_param(const HttpRequest* req, const char* key) {
+const char* http_get_query_param(HttpRequest* req, const char* key) {
     if (!req || !key) return NULL;
-    
+    ensure_query_params(req);
+
     for (int i = 0; i < req->query_param_count; i++) {
         if (strcmp(req->query_params[i].key, key) == 0) {
             return req->query_params[i].value;
@@ -225,13 +276,14 @@ const char* http_get_query_param(const HttpRequest* req, const char* key) {
     return NULL;
 }
 
-const char* http_get_body_param(const HttpRequest* req, const char* key) {
+const char* http_get_body_param(HttpRequest* req, const char* key) {
     if (!req || !key) return NULL;
-    
+    ensure_body_params(req);
+
     for (int i = 0; i < req->body_param_count; i++) {
         if (strcmp(req->body_params[i].key, key) == 0) {
             return req->body_params[i].value;
         }
     }
     return NULL;
-}
\ No newline at end of file
+}
@@ -0,0 +1,197 @@
+#define _GNU_SOURCE
+#include "worker_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include "logger.h"
+
+typedef struct WorkerJob {
+    WorkerJobFn job;
+    WorkerDoneFn done;
+    void* arg;
+    struct WorkerJob* next;
+} WorkerJob;
+
+// Singly linked FIFO
+typedef struct {
+    WorkerJob* head;
+    WorkerJob* tail;
+} JobQueue;
+
+static struct {
+    pthread_t* threads;
+    int thread_count;
+    int event_fd;
+    bool stopping;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    JobQueue pending;    // Waiting for a worker
+    JobQueue finished;   // Waiting for the reactor
+} P = { .event_fd = -1 };
+
+static void queue_push(JobQueue* q, WorkerJob* j) {
+    j->next = NULL;
+    if (q->tail) {
+        q->tail->next = j;
+    } else {
+        q->head = j;
+    }
+    q->tail = j;
+}
+
+static WorkerJob* queue_pop(JobQueue* q) {
+    WorkerJob* j = q->head;
+    if (j) {
+        q->head = j->next;
+        if (!q->head) q->tail = NULL;
+    }
+    return j;
+}
+
+static void* worker_main(void* unused) {
+    (void)unused;
+    pthread_mutex_lock(&P.lock);
+    while (1) {
+        while (!P.pending.head && !P.stopping) {
+            pthread_cond_wait(&P.cond, &P.lock);
+        }
+        WorkerJob* j = queue_pop(&P.pending);
+        if (!j) break; // Stopping and drained
+        pthread_mutex_unlock(&P.lock);
+
+        j->job(j->arg);
+
+        pthread_mutex_lock(&P.lock);
+        queue_push(&P.finished, j);
+        // Wake the reactor; the counter value itself is irrelevant.
+        // A failed write can only mean the counter is saturated, i.e. already readable.
+        uint64_t one = 1;
+        ssize_t written = write(P.event_fd, &one, sizeof(one));
+        (void)written;
+    }
+    pthread_mutex_unlock(&P.lock);
+    return NULL;
+}
+
+int worker_pool_init(int thread_count) {
+    if (P.thread_count > 0 || thread_count <= 0) {
+        return 0;
+    }
+
+    P.event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (P.event_fd == -1) {
+        log_system(LOG_ERROR, "WorkerPool: eventfd: %s", strerror(errno));
+        return -1;
+    }
+    pthread_mutex_init(&P.lock, NULL);
+    pthread_cond_init(&P.cond, NULL);
+    P.stopping = false;
+
+    P.threads = calloc(thread_count, sizeof(pthread_t));
+    if (!P.threads) {
+        close(P.event_fd);
+        P.event_fd = -1;
+        return -1;
+    }
+    for (int i = 0; i < thread_count; i++) {
+        if (pthread_create(&P.threads[i], NULL, worker_main, NULL) != 0) {
+            log_system(LOG_ERROR, "WorkerPool: Could only start %d of %d threads.", i, thread_count);
+            break;
+        }
+        P.thread_count++;
+    }
+    if (P.thread_count == 0) {
+        free(P.threads);
+        P.threads = NULL;
+        close(P.event_fd);
+        P.event_fd = -1;
+        return -1;
+    }
+
+    log_system(LOG_INFO, "WorkerPool: Started %d threads.", P.thread_count);
+    return 0;
+}
+
+int worker_pool_enabled() {
+    return P.thread_count > 0;
+}
+
+int worker_pool_submit(WorkerJobFn job, WorkerDoneFn done, void* arg) {
+    if (P.thread_count == 0) {
+        return -1;
+    }
+    WorkerJob* j = malloc(sizeof(WorkerJob));
+    if (!j) {
+        return -1;
+    }
+    j->job = job;
+    j->done = done;
+    j->arg = arg;
+
+    pthread_mutex_lock(&P.lock);
+    queue_push(&P.pending, j);
+    pthread_cond_signal(&P.cond);
+    pthread_mutex_unlock(&P.lock);
+    return 0;
+}
+
+int worker_pool_event_fd() {
+    return P.event_fd;
+}
+
+void worker_pool_run_completions() {
+    if (P.event_fd == -1) {
+        return;
+    }
+    uint64_t counter;
+    while (read(P.event_fd, &counter, sizeof(counter)) == sizeof(counter)) {
+        // Drain the eventfd; completions are taken from the queue below
+    }
+
+    // Detach the whole list under the lock, run callbacks without it
+    pthread_mutex_lock(&P.lock);
+    WorkerJob* j = P.finished.head;
+    P.finished.head = P.finished.tail = NULL;
+    pthread_mutex_unlock(&P.lock);
+
+    while (j) {
+        WorkerJob* next = j->next;
+        if (j->done) {
+            j->done(j->arg);
+        }
+        free(j);
+        j = next;
+    }
+}
+
+void worker_pool_shutdown() {
+    if (P.thread_count == 0) {
+        return;
+    }
+    pthread_mutex_lock(&P.lock);
+    P.stopping = true;
+    pthread_cond_broadcast(&P.cond);
+    pthread_mutex_unlock(&P.lock);
+
+    for (int i = 0; i < P.thread_count; i++) {
+        pthread_join(P.threads[i], NULL);
+    }
+    free(P.threads);
+    P.threads = NULL;
+    P.thread_count = 0;
+
+    WorkerJob* j;
+    while ((j = queue_pop(&P.finished)) != NULL) {
+        free(j);
+    }
+    close(P.event_fd);
+    P.event_fd = -1;
+    pthread_mutex_destroy(&P.lock);
+    pthread_cond_destroy(&P.cond);
+}
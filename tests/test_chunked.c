@@ -0,0 +1,34 @@
+// Chunk-size line parsing in http_chunked_decode().
+#include "http.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+// Decodes a complete chunked body and checks the result code (and, on success, the data).
+static void check(const char* name, const char* input, int want_rc, const char* want_body) {
+    HttpRequest req;
+    memset(&req, 0, sizeof(req)); // chunk_state starts at CHUNK_STATE_SIZE
+    char buf[256];
+    size_t len = strlen(input);
+    memcpy(buf, input, len);
+    size_t in = 0, out = 0;
+    int rc = http_chunked_decode(&req, buf, len, &in, &out);
+    if (rc != want_rc || (want_body && (out != strlen(want_body) || memcmp(buf, want_body, out) != 0))) {
+        printf("FAIL %s: rc=%d (want %d)\n", name, rc, want_rc);
+        failures++;
+    }
+}
+
+int main() {
+    check("plain", "5\r\nhello\r\n0\r\n\r\n", 1, "hello");
+    check("whitespace before CRLF", "5 \t\r\nhello\r\n0\r\n\r\n", 1, "hello");
+    check("whitespace before extension", "5 ;a=b\r\nhello\r\n0\r\n\r\n", 1, "hello");
+    check("garbage after size", "5 garbage\r\nhello\r\n0\r\n\r\n", -1, NULL);
+    check("whitespace-only size line", " \r\nhello\r\n0\r\n\r\n", -1, NULL);
+    check("extension without size", "  ;ext\r\nhello\r\n0\r\n\r\n", -1, NULL);
+    check("empty size line", "\r\n0\r\n\r\n", -1, NULL);
+
+    if (failures == 0) printf("test_chunked: OK\n");
+    return failures ? 1 : 0;
+}
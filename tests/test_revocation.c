@@ -0,0 +1,47 @@
+// Revocation snapshot: save and reload, including keys whose escaped form is long.
+#include "revocation.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while (0)
+
+int main() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/test_revocation_%d.snap", (int)getpid());
+    unlink(path);
+    time_t now = time(NULL);
+
+    // 600 newlines escape to 1800 bytes; each one would otherwise start a new line
+    char user[601];
+    memset(user, '\n', 600);
+    user[600] = '\0';
+    char jti[2001];
+    memset(jti, 'j', 2000);
+    jti[2000] = '\0';
+    const char* injected = "x\nJ 0 9999999999 other%";
+
+    CHECK(revocation_init(path) == 0);
+    CHECK(revocation_add_user(user, now, now + 3600) == 0);
+    CHECK(revocation_add_token_id(jti, now + 3600) == 0);
+    CHECK(revocation_add_user(injected, now, now + 3600) == 0);
+    revocation_tick(); // First write after an idle period happens at once
+
+    CHECK(revocation_init(path) == 0); // Reload from the snapshot
+    CHECK(revocation_is_revoked(NULL, user, now - 1));
+    CHECK(revocation_is_revoked(jti, "someone", now - 1));
+    CHECK(revocation_is_revoked(NULL, injected, now - 1));
+    CHECK(!revocation_is_revoked("other%", "someone", now - 1));
+    CHECK(!revocation_is_revoked(NULL, "x", now - 1));
+    CHECK(!revocation_is_revoked("jjjj", "someone", now - 1));
+
+    unlink(path);
+    if (failures == 0) printf("test_revocation: OK\n");
+    return failures ? 1 : 0;
+}